@@ -0,0 +1,64 @@
+/*--------------------------------------------------------------------*/
+/* bin5.c                                                             */
+/* Author: Isaac Wolfe and Isaac Hart                                 */
+/*--------------------------------------------------------------------*/
+
+#include "bin5.h"
+#include <stddef.h>
+#include <assert.h>
+
+/*--------------------------------------------------------------------*/
+
+/* The number of bins per power of two. */
+enum {BIN_SUBS = 1 << BIN_SUB_BITS};
+
+/*--------------------------------------------------------------------*/
+
+int Bin_fromUnits(size_t uUnits)
+{
+   int iExponent;
+   int iSub;
+
+   if (uUnits < (size_t)BIN_LINEAR_UNITS)
+      return (int)uUnits;
+
+   /* Find the power of two at or below uUnits, and which of its
+      BIN_SUBS equal parts uUnits lies in. */
+   iExponent = (int)(sizeof(unsigned long) * CHAR_BIT) - 1
+      - __builtin_clzl((unsigned long)uUnits);
+   iSub = (int)(uUnits >> (iExponent - BIN_SUB_BITS)) & (BIN_SUBS - 1);
+
+   return BIN_LINEAR_UNITS
+      + ((iExponent - BIN_LINEAR_BITS) << BIN_SUB_BITS) + iSub;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Bin_toMinUnits(int iBin)
+{
+   int iExponent;
+   int iSub;
+
+   assert(iBin >= 0);
+   assert(iBin < BIN_COUNT);
+
+   if (iBin < BIN_LINEAR_UNITS)
+      return (size_t)iBin;
+
+   iExponent = ((iBin - BIN_LINEAR_UNITS) >> BIN_SUB_BITS)
+      + BIN_LINEAR_BITS;
+   iSub = (iBin - BIN_LINEAR_UNITS) & (BIN_SUBS - 1);
+
+   return ((size_t)1 << iExponent)
+      + ((size_t)iSub << (iExponent - BIN_SUB_BITS));
+}
+
+/*--------------------------------------------------------------------*/
+
+int Bin_isExact(int iBin)
+{
+   assert(iBin >= 0);
+   assert(iBin < BIN_COUNT);
+
+   return iBin < BIN_LINEAR_UNITS;
+}
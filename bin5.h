@@ -0,0 +1,57 @@
+/*--------------------------------------------------------------------*/
+/* bin5.h                                                             */
+/* Author: Isaac Wolfe and Isaac Hart                                 */
+/*--------------------------------------------------------------------*/
+
+#ifndef BIN5_INCLUDED
+#define BIN5_INCLUDED
+
+#include <stddef.h>
+#include <limits.h>
+
+/* The bins hold free Chunks by size. A Chunk of fewer than
+   BIN_LINEAR_UNITS units is in the exact bin whose index is its number
+   of units. Above that the bins are logarithmic: each range of sizes
+   from one power of two up to the next is split into
+   2^BIN_SUB_BITS bins of equal width. The layout can be changed by
+   defining BIN_LINEAR_BITS and BIN_SUB_BITS when compiling; every
+   module that includes this file must agree on them. */
+
+/* The base-2 logarithm of the number of exact bins. */
+#ifndef BIN_LINEAR_BITS
+#define BIN_LINEAR_BITS 6
+#endif
+
+/* The base-2 logarithm of the number of bins per power of two. It
+   may not exceed BIN_LINEAR_BITS. */
+#ifndef BIN_SUB_BITS
+#define BIN_SUB_BITS 2
+#endif
+
+/* The number of exact bins, and the total number of bins. */
+enum {BIN_LINEAR_UNITS = 1 << BIN_LINEAR_BITS};
+enum {BIN_COUNT = BIN_LINEAR_UNITS +
+   (((int)(sizeof(size_t) * CHAR_BIT) - BIN_LINEAR_BITS)
+      << BIN_SUB_BITS)};
+
+/*--------------------------------------------------------------------*/
+
+/* Return the index of the bin that holds free Chunks of uUnits
+   units. */
+
+int Bin_fromUnits(size_t uUnits);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the smallest number of units of a Chunk in bin iBin. */
+
+size_t Bin_toMinUnits(int iBin);
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) if every Chunk in bin iBin has the same number of
+   units, or 0 (FALSE) if the bin holds a range of sizes. */
+
+int Bin_isExact(int iBin);
+
+#endif
@@ -0,0 +1,496 @@
+/*--------------------------------------------------------------------*/
+/* checker5.c                                                         */
+/* Author: Isaac Wolfe and Isaac Hart                                 */
+/*--------------------------------------------------------------------*/
+
+#include "checker5.h"
+#include "bin5.h"
+#include "segment5.h"
+#include <stdio.h>
+#include <limits.h>
+
+/* In lieu of a boolean data type. */
+enum {FALSE, TRUE};
+
+/* The number of bins tracked by one word of the bin map. */
+enum {BITS_PER_WORD = (int)(sizeof(unsigned long) * CHAR_BIT)};
+
+/*--------------------------------------------------------------------*/
+
+/* Internal function declarations */
+
+/* Return TRUE if oChunk is a valid chunk within the chunks of a
+   segment, and FALSE otherwise. */
+static int Checker_chunkIsValid(Chunk_T oChunk);
+
+/* Traverse the chunks of oSegment, and add the number of free chunks
+   to *piFreeCount. Return TRUE if every chunk is valid, no two free
+   chunks are contiguous and every chunk's status is recorded properly
+   in the next chunk's header (the segment's end chunk for the last),
+   and FALSE otherwise. */
+static int Checker_memIsValid(Segment_T oSegment, int *piFreeCount);
+
+/* Return TRUE if oFreeList is devoid of cycles, and FALSE otherwise. */
+static int Checker_noCycle(Chunk_T oFreeList);
+
+/* Traverse oFreeList, the list of exact bin iBin, and add its length
+   to *piListCount. Return TRUE if every chunk in it is valid, free,
+   in the proper bin and properly linked, and FALSE otherwise. */
+static int Checker_binIsValid(Chunk_T oFreeList, int iBin,
+   int *piListCount);
+
+/* Return TRUE if oChunk orders before oOtherChunk in a bin's treap,
+   and FALSE otherwise. */
+static int Checker_treeIsBefore(Chunk_T oChunk, Chunk_T oOtherChunk);
+
+/* Traverse the treap rooted at oRoot, part of bin iBin, whose chunks
+   must order after oLow and before oHigh (either of which may be
+   NULL), and add its size to *piListCount, which may not exceed
+   iMaxCount. Return TRUE if every chunk in it is valid, free, in the
+   proper bin and in order, and FALSE otherwise. */
+static int Checker_treeIsValid(Chunk_T oRoot, int iBin, Chunk_T oLow,
+   Chunk_T oHigh, int *piListCount, int iMaxCount);
+
+/* Return TRUE if aulBinMap and ulBinMapSummary agree with the
+   iBinCount bins in bins, and FALSE otherwise. */
+static int Checker_binMapIsValid(Chunk_T bins[], int iBinCount,
+   unsigned long aulBinMap[], unsigned long ulBinMapSummary);
+
+/* Traverse oFastList, the list of fast bin iUnits. Return TRUE if
+   every chunk in it is valid, in use and of iUnits units, and FALSE
+   otherwise. */
+static int Checker_fastBinIsValid(Chunk_T oFastList, int iUnits);
+
+/*--------------------------------------------------------------------*/
+
+/* Return TRUE if oChunk is a valid chunk within the chunks of the
+   segment that holds it, that is, between its sentinels, and FALSE
+   otherwise. */
+
+static int Checker_chunkIsValid(Chunk_T oChunk)
+{
+   Segment_T oSegment = Segment_fromChunk(oChunk);
+
+   if (oSegment == NULL)
+   {
+      fprintf(stderr, "A chunk is in no segment\n");
+      return FALSE;
+   }
+   return Chunk_isValid(oChunk, Segment_getFirstChunk(oSegment),
+      Segment_getEnd(oSegment));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Traverse the chunks of oSegment, from the one after its first
+   sentinel to its end chunk, and add the number of free chunks to
+   *piFreeCount. Return TRUE if every chunk is valid, no two free
+   chunks are contiguous and every chunk's status is recorded properly
+   in the next chunk's header (the segment's end chunk for the last),
+   and FALSE otherwise. */
+
+static int Checker_memIsValid(Segment_T oSegment, int *piFreeCount)
+{
+   Chunk_T oChunk;
+   Chunk_T oNextChunk;
+   Chunk_T oStart = Segment_getFirstChunk(oSegment);
+   Chunk_T oEnd = Segment_getEnd(oSegment);
+   enum ChunkStatus ePrevStatus = CHUNK_INUSE;
+
+   for (oChunk = oStart;
+        oChunk != oEnd;
+        oChunk = oNextChunk)
+   {
+      /* Is the chunk valid? */
+      if (! Chunk_isValid(oChunk, oStart, oEnd))
+      {
+         fprintf(stderr, "Traversing memory detected a bad chunk\n");
+         return FALSE;
+      }
+
+      /* Is the chunk part of the heap rather than mapped? */
+      if (Chunk_isMapped(oChunk))
+      {
+         fprintf(stderr, "A chunk in the heap is marked mapped\n");
+         return FALSE;
+      }
+
+      /* Does the chunk record the previous chunk's status? */
+      if (Chunk_getPrevStatus(oChunk) != ePrevStatus)
+      {
+         fprintf(stderr, "A chunk has a wrong previous status\n");
+         return FALSE;
+      }
+      ePrevStatus = Chunk_getStatus(oChunk);
+
+      oNextChunk =
+         Chunk_getNextInMem(oChunk, Segment_getLimit(oSegment));
+      if (Chunk_getStatus(oChunk) != CHUNK_FREE)
+      {
+         /* Only a free chunk's pages can have been purged. */
+         if (Chunk_isPurged(oChunk))
+         {
+            fprintf(stderr, "A chunk in use is marked purged\n");
+            return FALSE;
+         }
+         continue;
+      }
+      (*piFreeCount)++;
+
+      /* Is the next chunk in memory in use, or too large to merge? */
+      if ((Chunk_getStatus(oNextChunk) == CHUNK_FREE)
+         && (Chunk_getUnits(oChunk) + Chunk_getUnits(oNextChunk)
+            <= MAX_UNITS_PER_CHUNK))
+      {
+         fprintf(stderr, "The heap contains contiguous free chunks\n");
+         return FALSE;
+      }
+   }
+
+   /* Is the last chunk's status recorded properly? */
+   if (Chunk_getPrevStatus(oEnd) != ePrevStatus)
+   {
+      fprintf(stderr, "The last chunk's status is recorded wrongly\n");
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return TRUE if oFreeList is devoid of cycles, and FALSE otherwise.
+   Use Floyd's algorithm to find out. See the Wikipedia "Cycle
+   detection" page for a description. */
+
+static int Checker_noCycle(Chunk_T oFreeList)
+{
+   Chunk_T oTortoiseChunk;
+   Chunk_T oHareChunk;
+
+   oTortoiseChunk = oFreeList;
+   oHareChunk = oFreeList;
+   if (oHareChunk != NULL)
+      oHareChunk = Chunk_getNextInList(oHareChunk);
+   while (oHareChunk != NULL)
+   {
+      if (oTortoiseChunk == oHareChunk)
+         return FALSE;
+      /* Move oTortoiseChunk one step. */
+      oTortoiseChunk = Chunk_getNextInList(oTortoiseChunk);
+      /* Move oHareChunk two steps, if possible. */
+      oHareChunk = Chunk_getNextInList(oHareChunk);
+      if (oHareChunk != NULL)
+         oHareChunk = Chunk_getNextInList(oHareChunk);
+   }
+
+   return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Traverse oFreeList, the list of exact bin iBin, and add its length
+   to *piListCount. Return TRUE if every chunk in it is valid, free,
+   in the proper bin and properly linked, and FALSE otherwise. */
+
+static int Checker_binIsValid(Chunk_T oFreeList, int iBin,
+   int *piListCount)
+{
+   Chunk_T oChunk;
+   Chunk_T oNextChunk;
+
+   /* Does the front of the bin point to a previous chunk? */
+   if ((oFreeList != NULL) && (Chunk_getPrevInList(oFreeList) != NULL))
+   {
+      fprintf(stderr, "The front of a bin has a previous chunk\n");
+      return FALSE;
+   }
+
+   for (oChunk = oFreeList;
+        oChunk != NULL;
+        oChunk = oNextChunk)
+   {
+      /* Is the chunk valid? */
+      if (! Checker_chunkIsValid(oChunk))
+      {
+         fprintf(stderr, "Traversing a bin detected a bad chunk\n");
+         return FALSE;
+      }
+
+      /* Is the chunk free? */
+      if (Chunk_getStatus(oChunk) != CHUNK_FREE)
+      {
+         fprintf(stderr, "A bin contains a chunk that is in use\n");
+         return FALSE;
+      }
+
+      /* Is the chunk in the proper bin? */
+      if (Bin_fromUnits(Chunk_getUnits(oChunk)) != iBin)
+      {
+         fprintf(stderr, "A chunk is in the wrong bin\n");
+         return FALSE;
+      }
+
+      /* Does the next chunk in the list point back to this one? */
+      oNextChunk = Chunk_getNextInList(oChunk);
+      if ((oNextChunk != NULL)
+         && (Chunk_getPrevInList(oNextChunk) != oChunk))
+      {
+         fprintf(stderr, "A bin is misaligned\n");
+         return FALSE;
+      }
+
+      (*piListCount)++;
+   }
+
+   return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return TRUE if oChunk orders before oOtherChunk in a bin's treap,
+   that is, if it is smaller or equally large at a lower address, and
+   FALSE otherwise. */
+
+static int Checker_treeIsBefore(Chunk_T oChunk, Chunk_T oOtherChunk)
+{
+   if (Chunk_getUnits(oChunk) != Chunk_getUnits(oOtherChunk))
+      return Chunk_getUnits(oChunk) < Chunk_getUnits(oOtherChunk);
+   return oChunk < oOtherChunk;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Traverse the treap rooted at oRoot, part of bin iBin, whose chunks
+   must order after oLow and before oHigh (either of which may be
+   NULL), and add its size to *piListCount, which may not exceed
+   iMaxCount. Return TRUE if every chunk in it is valid, free, in the
+   proper bin and in order, and FALSE otherwise. */
+
+static int Checker_treeIsValid(Chunk_T oRoot, int iBin, Chunk_T oLow,
+   Chunk_T oHigh, int *piListCount, int iMaxCount)
+{
+   if (oRoot == NULL)
+      return TRUE;
+
+   /* Has the traversal seen more chunks than are free? If so, the
+      treap must share a chunk between subtrees or have a cycle. */
+   (*piListCount)++;
+   if (*piListCount > iMaxCount)
+   {
+      fprintf(stderr, "The treap has a cycle or a shared chunk\n");
+      return FALSE;
+   }
+
+   /* Is the chunk valid, free, and in the proper bin? */
+   if (! Checker_chunkIsValid(oRoot))
+   {
+      fprintf(stderr, "Traversing the treap detected a bad chunk\n");
+      return FALSE;
+   }
+   if (Chunk_getStatus(oRoot) != CHUNK_FREE)
+   {
+      fprintf(stderr, "The treap contains a chunk that is in use\n");
+      return FALSE;
+   }
+   if (Bin_fromUnits(Chunk_getUnits(oRoot)) != iBin)
+   {
+      fprintf(stderr, "A treap contains a chunk of the wrong bin\n");
+      return FALSE;
+   }
+
+   /* Is the chunk in order? */
+   if (((oLow != NULL) && (! Checker_treeIsBefore(oLow, oRoot)))
+      || ((oHigh != NULL) && (! Checker_treeIsBefore(oRoot, oHigh))))
+   {
+      fprintf(stderr, "The treap is out of order\n");
+      return FALSE;
+   }
+
+   return Checker_treeIsValid(Chunk_getLeftInTree(oRoot), iBin, oLow,
+         oRoot, piListCount, iMaxCount)
+      && Checker_treeIsValid(Chunk_getRightInTree(oRoot), iBin, oRoot,
+         oHigh, piListCount, iMaxCount);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return TRUE if aulBinMap and ulBinMapSummary agree with the
+   iBinCount bins in bins, and FALSE otherwise. */
+
+static int Checker_binMapIsValid(Chunk_T bins[], int iBinCount,
+   unsigned long aulBinMap[], unsigned long ulBinMapSummary)
+{
+   int iBin;
+   int iWord;
+   int iBitSet;
+
+   for (iBin = 0; iBin < iBinCount; iBin++)
+   {
+      iWord = iBin / BITS_PER_WORD;
+      iBitSet = (aulBinMap[iWord] >> (iBin % BITS_PER_WORD)) & 1UL;
+      if (iBitSet != (bins[iBin] != NULL))
+      {
+         fprintf(stderr, "The bin map disagrees with a bin\n");
+         return FALSE;
+      }
+   }
+
+   for (iWord = 0;
+        iWord < (iBinCount + BITS_PER_WORD - 1) / BITS_PER_WORD;
+        iWord++)
+   {
+      iBitSet = (ulBinMapSummary >> iWord) & 1UL;
+      if (iBitSet != (aulBinMap[iWord] != 0))
+      {
+         fprintf(stderr, "The bin map summary disagrees with a word\n");
+         return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Traverse oFastList, the list of fast bin iUnits. Return TRUE if
+   every chunk in it is valid, in use and of iUnits units, and FALSE
+   otherwise. */
+
+static int Checker_fastBinIsValid(Chunk_T oFastList, int iUnits)
+{
+   Chunk_T oChunk;
+
+   if (! Checker_noCycle(oFastList))
+   {
+      fprintf(stderr, "A fast bin has a cycle\n");
+      return FALSE;
+   }
+
+   for (oChunk = oFastList;
+        oChunk != NULL;
+        oChunk = Chunk_getNextInList(oChunk))
+   {
+      if (! Checker_chunkIsValid(oChunk))
+      {
+         fprintf(stderr, "A fast bin contains a bad chunk\n");
+         return FALSE;
+      }
+      if (Chunk_getStatus(oChunk) != CHUNK_INUSE)
+      {
+         fprintf(stderr, "A fast bin contains a free chunk\n");
+         return FALSE;
+      }
+      if (Chunk_getUnits(oChunk) != (size_t)iUnits)
+      {
+         fprintf(stderr, "A chunk is in the wrong fast bin\n");
+         return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Checker_isValid(Chunk_T bins[], int iBinCount,
+   unsigned long aulBinMap[], unsigned long ulBinMapSummary,
+   Chunk_T oTop, Chunk_T aoFastBins[], int iFastBinCount)
+{
+   Segment_T oSegment;
+   int iBin;
+   int iMemCount = 0;
+   int iListCount = 0;
+
+   /* Does the bin map agree with the bins? */
+   if (! Checker_binMapIsValid(bins, iBinCount, aulBinMap,
+      ulBinMapSummary))
+      return FALSE;
+
+   /* If the heap has no segments, are the bins empty too? */
+   if (Segment_getFirst() == NULL)
+   {
+      for (iBin = 0; iBin < iBinCount; iBin++)
+         if (bins[iBin] != NULL)
+         {
+            fprintf(stderr, "The heap is empty, but a bin is not\n");
+            return FALSE;
+         }
+      for (iBin = 0; iBin < iFastBinCount; iBin++)
+         if (aoFastBins[iBin] != NULL)
+         {
+            fprintf(stderr,
+               "The heap is empty, but a fast bin is not\n");
+            return FALSE;
+         }
+      if (oTop != NULL)
+      {
+         fprintf(stderr, "The heap is empty, but has a top chunk\n");
+         return FALSE;
+      }
+      return TRUE;
+   }
+
+   /* Traverse the memory of each segment. */
+   for (oSegment = Segment_getFirst();
+        oSegment != NULL;
+        oSegment = Segment_getNext(oSegment))
+      if (! Checker_memIsValid(oSegment, &iMemCount))
+         return FALSE;
+
+   /* Is the top chunk the last chunk of the newest segment, and free,
+      and is there one iff that chunk is free? */
+   oSegment = Segment_getFirst();
+   if (oTop != NULL)
+   {
+      if ((! Checker_chunkIsValid(oTop))
+         || (Segment_fromChunk(oTop) != oSegment)
+         || (Chunk_getNextInMem(oTop, Segment_getLimit(oSegment))
+            != Segment_getEnd(oSegment))
+         || (Chunk_getStatus(oTop) != CHUNK_FREE))
+      {
+         fprintf(stderr, "The top chunk is not the last free chunk\n");
+         return FALSE;
+      }
+      iListCount++;
+   }
+   else if (Chunk_getPrevStatus(Segment_getEnd(oSegment)) == CHUNK_FREE)
+   {
+      fprintf(stderr, "The last chunk is free, but not the top\n");
+      return FALSE;
+   }
+
+   /* Traverse the bins: the list of each exact bin, and the treap of
+      each other bin. */
+   for (iBin = 0; iBin < iBinCount; iBin++)
+   {
+      if (Bin_isExact(iBin))
+      {
+         if (! Checker_noCycle(bins[iBin]))
+         {
+            fprintf(stderr, "A bin has a cycle\n");
+            return FALSE;
+         }
+         if (! Checker_binIsValid(bins[iBin], iBin, &iListCount))
+            return FALSE;
+      }
+      else if (! Checker_treeIsValid(bins[iBin], iBin, NULL, NULL,
+         &iListCount, iMemCount))
+         return FALSE;
+   }
+
+   /* Traverse the fast bins. */
+   for (iBin = 0; iBin < iFastBinCount; iBin++)
+      if (! Checker_fastBinIsValid(aoFastBins[iBin], iBin))
+         return FALSE;
+
+   /* Is every free chunk in memory in some bin, or the top chunk? */
+   if (iMemCount != iListCount)
+   {
+      fprintf(stderr,
+         "Number of free chunks in the bins and memory not equal\n");
+      return FALSE;
+   }
+
+   return TRUE;
+}
@@ -9,12 +9,21 @@
 #include "chunk5.h"
 
 /* Return 1 (TRUE) if the heap is in a valid state, or 0 (FALSE)
-   otherwise. The heap is defined by parameters oHeapStart (the address
-   of the start of the heap), oHeapEnd (the address immediately 
-   beyond the end of the heap), and aoBins (an array of iBinCount bins,
-   where each bin contains free chunks). */
+   otherwise. The heap is defined by its list of segments (see
+   segment5.h) and by parameters aoBins (an array of iBinCount bins,
+   laid out as described in bin5.h, where each exact bin is a list of
+   free chunks and each other bin is a treap of free chunks),
+   aulBinMap (an array with one bit per bin, set iff the bin is
+   non-empty), ulBinMapSummary (a word with one bit per element of
+   aulBinMap, set iff that element is non-zero), oTop (the last chunk
+   of the newest segment if it is free, and then in no bin, or else
+   NULL), and aoFastBins (an array of iFastBinCount fast bins, where
+   fast bin i is a list, linked by next pointers alone, of chunks of i
+   units whose freeing was deferred and whose status is still in
+   use). */
 
-int Checker_isValid(Chunk_T oHeapStart, Chunk_T oHeapEnd,
-   Chunk_T bins[], int iBinCount);
+int Checker_isValid(Chunk_T bins[], int iBinCount,
+   unsigned long aulBinMap[], unsigned long ulBinMapSummary,
+   Chunk_T oTop, Chunk_T aoFastBins[], int iFastBinCount);
 
 #endif
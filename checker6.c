@@ -0,0 +1,277 @@
+/*--------------------------------------------------------------------*/
+/* checker6.c                                                         */
+/* Author: Isaac Wolfe and Isaac Hart                                 */
+/*--------------------------------------------------------------------*/
+
+#include "checker6.h"
+#include <stdio.h>
+#include <limits.h>
+
+/* In lieu of a boolean data type. */
+enum {FALSE, TRUE};
+
+/*--------------------------------------------------------------------*/
+
+/* Internal function declarations */
+
+/* Return the index in aoLists of the list in which a free chunk of
+   uUnits units belongs, given iSlCount lists per first level class. */
+static int Checker_listIndex(size_t uUnits, int iSlCount);
+
+/* Traverse memory from oHeapStart to oHeapEnd, and store the number
+   of free chunks in *piFreeCount. Return TRUE if every chunk is valid,
+   no two free chunks are contiguous and every chunk's status is
+   recorded properly in the next chunk's header (or in eLastStatus for
+   the last chunk), and FALSE otherwise. */
+static int Checker_memIsValid(Chunk_T oHeapStart, Chunk_T oHeapEnd,
+   enum ChunkStatus eLastStatus, int *piFreeCount);
+
+/* Traverse oFreeList, list iList of aoLists, and add its length to
+   *piListCount, which may not exceed iMaxCount. Return TRUE if every
+   chunk in it is valid, free, in the proper list and properly linked,
+   and FALSE otherwise. */
+static int Checker_listIsValid(Chunk_T oFreeList, int iList,
+   int iSlCount, Chunk_T oHeapStart, Chunk_T oHeapEnd,
+   int *piListCount, int iMaxCount);
+
+/* Return TRUE if ulFlMap and aulSlMap agree with aoLists, and FALSE
+   otherwise. */
+static int Checker_mapsAreValid(Chunk_T aoLists[], int iFlCount,
+   int iSlCount, unsigned long ulFlMap, unsigned long aulSlMap[]);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the index in aoLists of the list in which a free chunk of
+   uUnits units belongs, given iSlCount lists per first level class.
+   This must agree with the mapping of heapmgr6.c. */
+
+static int Checker_listIndex(size_t uUnits, int iSlCount)
+{
+   int iSlBits = 0;
+   int iLog = 0;
+
+   if (uUnits < (size_t)iSlCount)
+      return (int)uUnits;
+
+   while ((1 << iSlBits) < iSlCount)
+      iSlBits++;
+   while ((uUnits >> iLog) > 1)
+      iLog++;
+
+   return ((iLog - iSlBits + 1) * iSlCount)
+      + (int)(uUnits >> (iLog - iSlBits)) - iSlCount;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Traverse memory from oHeapStart to oHeapEnd, and store the number
+   of free chunks in *piFreeCount. Return TRUE if every chunk is valid,
+   no two free chunks are contiguous and every chunk's status is
+   recorded properly in the next chunk's header (or in eLastStatus for
+   the last chunk), and FALSE otherwise. */
+
+static int Checker_memIsValid(Chunk_T oHeapStart, Chunk_T oHeapEnd,
+   enum ChunkStatus eLastStatus, int *piFreeCount)
+{
+   Chunk_T oChunk;
+   Chunk_T oNextChunk;
+   enum ChunkStatus ePrevStatus = CHUNK_INUSE;
+
+   *piFreeCount = 0;
+   for (oChunk = oHeapStart;
+        oChunk != NULL;
+        oChunk = oNextChunk)
+   {
+      /* Is the chunk valid? */
+      if (! Chunk_isValid(oChunk, oHeapStart, oHeapEnd))
+      {
+         fprintf(stderr, "Traversing memory detected a bad chunk\n");
+         return FALSE;
+      }
+
+      /* Does the chunk record the previous chunk's status? */
+      if (Chunk_getPrevStatus(oChunk) != ePrevStatus)
+      {
+         fprintf(stderr, "A chunk has a wrong previous status\n");
+         return FALSE;
+      }
+      ePrevStatus = Chunk_getStatus(oChunk);
+
+      oNextChunk = Chunk_getNextInMem(oChunk, oHeapEnd);
+      if (Chunk_getStatus(oChunk) != CHUNK_FREE)
+         continue;
+      (*piFreeCount)++;
+
+      /* Is the next chunk in memory in use, or too large to merge? */
+      if ((oNextChunk != NULL)
+         && (Chunk_getStatus(oNextChunk) == CHUNK_FREE)
+         && (Chunk_getUnits(oChunk) + Chunk_getUnits(oNextChunk)
+            <= MAX_UNITS_PER_CHUNK))
+      {
+         fprintf(stderr, "The heap contains contiguous free chunks\n");
+         return FALSE;
+      }
+   }
+
+   /* Is the last chunk's status recorded properly? */
+   if (ePrevStatus != eLastStatus)
+   {
+      fprintf(stderr, "The last chunk's status is recorded wrongly\n");
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Traverse oFreeList, list iList of aoLists, and add its length to
+   *piListCount, which may not exceed iMaxCount. Return TRUE if every
+   chunk in it is valid, free, in the proper list and properly linked,
+   and FALSE otherwise. */
+
+static int Checker_listIsValid(Chunk_T oFreeList, int iList,
+   int iSlCount, Chunk_T oHeapStart, Chunk_T oHeapEnd,
+   int *piListCount, int iMaxCount)
+{
+   Chunk_T oChunk;
+   Chunk_T oNextChunk;
+
+   /* Does the front of the list point to a previous chunk? */
+   if ((oFreeList != NULL) && (Chunk_getPrevInList(oFreeList) != NULL))
+   {
+      fprintf(stderr, "The front of a list has a previous chunk\n");
+      return FALSE;
+   }
+
+   for (oChunk = oFreeList;
+        oChunk != NULL;
+        oChunk = oNextChunk)
+   {
+      /* Has the traversal seen more chunks than are free? If so, some
+         list must have a cycle or share a chunk with another. */
+      (*piListCount)++;
+      if (*piListCount > iMaxCount)
+      {
+         fprintf(stderr, "A list has a cycle or a shared chunk\n");
+         return FALSE;
+      }
+
+      /* Is the chunk valid and free? */
+      if (! Chunk_isValid(oChunk, oHeapStart, oHeapEnd))
+      {
+         fprintf(stderr, "Traversing a list detected a bad chunk\n");
+         return FALSE;
+      }
+      if (Chunk_getStatus(oChunk) != CHUNK_FREE)
+      {
+         fprintf(stderr, "A list contains a chunk that is in use\n");
+         return FALSE;
+      }
+
+      /* Is the chunk in the proper list? */
+      if (Checker_listIndex(Chunk_getUnits(oChunk), iSlCount) != iList)
+      {
+         fprintf(stderr, "A chunk is in the wrong list\n");
+         return FALSE;
+      }
+
+      /* Does the next chunk in the list point back to this one? */
+      oNextChunk = Chunk_getNextInList(oChunk);
+      if ((oNextChunk != NULL)
+         && (Chunk_getPrevInList(oNextChunk) != oChunk))
+      {
+         fprintf(stderr, "A list is misaligned\n");
+         return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return TRUE if ulFlMap and aulSlMap agree with aoLists, and FALSE
+   otherwise. */
+
+static int Checker_mapsAreValid(Chunk_T aoLists[], int iFlCount,
+   int iSlCount, unsigned long ulFlMap, unsigned long aulSlMap[])
+{
+   int iFl;
+   int iSl;
+   int iBitSet;
+
+   for (iFl = 0; iFl < iFlCount; iFl++)
+   {
+      iBitSet = (int)((ulFlMap >> iFl) & 1UL);
+      if (iBitSet != (aulSlMap[iFl] != 0))
+      {
+         fprintf(stderr, "The first level map is wrong\n");
+         return FALSE;
+      }
+
+      for (iSl = 0; iSl < iSlCount; iSl++)
+      {
+         iBitSet = (int)((aulSlMap[iFl] >> iSl) & 1UL);
+         if (iBitSet != (aoLists[(iFl * iSlCount) + iSl] != NULL))
+         {
+            fprintf(stderr, "The second level map is wrong\n");
+            return FALSE;
+         }
+      }
+   }
+
+   return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Checker_isValid(Chunk_T oHeapStart, Chunk_T oHeapEnd,
+   Chunk_T aoLists[], int iFlCount, int iSlCount,
+   unsigned long ulFlMap, unsigned long aulSlMap[],
+   enum ChunkStatus eLastStatus)
+{
+   int iList;
+   int iMemCount = 0;
+   int iListCount = 0;
+
+   /* Do oHeapStart and oHeapEnd have non-NULL values? */
+   if (oHeapStart == NULL)
+   {
+      fprintf(stderr, "The heap start is uninitialized\n");
+      return FALSE;
+   }
+   if (oHeapEnd == NULL)
+   {
+      fprintf(stderr, "The heap end is uninitialized\n");
+      return FALSE;
+   }
+
+   /* Do the bitmaps agree with the lists? */
+   if (! Checker_mapsAreValid(aoLists, iFlCount, iSlCount, ulFlMap,
+      aulSlMap))
+      return FALSE;
+
+   /* Traverse memory. If the heap is empty, this finds no free chunks,
+      so the lists must be empty too. */
+   if (oHeapStart != oHeapEnd)
+      if (! Checker_memIsValid(oHeapStart, oHeapEnd, eLastStatus,
+         &iMemCount))
+         return FALSE;
+
+   /* Traverse the lists. */
+   for (iList = 0; iList < iFlCount * iSlCount; iList++)
+      if (! Checker_listIsValid(aoLists[iList], iList, iSlCount,
+         oHeapStart, oHeapEnd, &iListCount, iMemCount))
+         return FALSE;
+
+   /* Is every free chunk in memory in some list? */
+   if (iMemCount != iListCount)
+   {
+      fprintf(stderr,
+         "Number of free chunks in the lists and memory not equal\n");
+      return FALSE;
+   }
+
+   return TRUE;
+}
@@ -0,0 +1,27 @@
+/*--------------------------------------------------------------------*/
+/* checker6.h                                                         */
+/* Author: Isaac Wolfe and Isaac Hart                                 */
+/*--------------------------------------------------------------------*/
+
+#ifndef CHECKER6_INCLUDED
+#define CHECKER6_INCLUDED
+
+#include "chunk5.h"
+
+/* Return 1 (TRUE) if the heap is in a valid state, or 0 (FALSE)
+   otherwise. The heap is defined by parameters oHeapStart (the address
+   of the start of the heap), oHeapEnd (the address immediately
+   beyond the end of the heap), aoLists (an array of iFlCount first
+   level classes of iSlCount free lists each, where iSlCount is a power
+   of two), ulFlMap (a word with one bit per first level class, set iff
+   the class has a non-empty list), and aulSlMap (an array with one
+   word per first level class, with one bit per list, set iff the list
+   is non-empty), and eLastStatus (the status of the last chunk in
+   memory). */
+
+int Checker_isValid(Chunk_T oHeapStart, Chunk_T oHeapEnd,
+   Chunk_T aoLists[], int iFlCount, int iSlCount,
+   unsigned long ulFlMap, unsigned long aulSlMap[],
+   enum ChunkStatus eLastStatus);
+
+#endif
@@ -0,0 +1,225 @@
+/*--------------------------------------------------------------------*/
+/* checker7.c                                                         */
+/* Author: Isaac Wolfe and Isaac Hart                                 */
+/*--------------------------------------------------------------------*/
+
+#include "checker7.h"
+#include <stdio.h>
+#include <stddef.h>
+
+/* In lieu of a boolean data type. */
+enum {FALSE, TRUE};
+
+/*--------------------------------------------------------------------*/
+
+/* Internal function declarations */
+
+/* Traverse memory from oHeapStart to oHeapEnd, and store the number
+   of free chunks in *piFreeCount. Return TRUE if every chunk is valid
+   and no free chunk smaller than the heap has a whole free buddy, and
+   FALSE otherwise. */
+static int Checker_memIsValid(Chunk_T oHeapStart, Chunk_T oHeapEnd,
+   int *piFreeCount);
+
+/* Traverse oFreeList, the list of order iOrder, and add its length to
+   *piListCount, which may not exceed iMaxCount. Return TRUE if every
+   chunk in it is valid, free, of order iOrder and properly linked, and
+   FALSE otherwise. */
+static int Checker_listIsValid(Chunk_T oFreeList, int iOrder,
+   Chunk_T oHeapStart, Chunk_T oHeapEnd, int *piListCount,
+   int iMaxCount);
+
+/* Return TRUE if ulOrderMap agrees with aoLists, and FALSE
+   otherwise. */
+static int Checker_mapIsValid(Chunk_T aoLists[], int iOrderCount,
+   unsigned long ulOrderMap);
+
+/*--------------------------------------------------------------------*/
+
+/* Traverse memory from oHeapStart to oHeapEnd, and store the number
+   of free chunks in *piFreeCount. Return TRUE if every chunk is valid
+   and no free chunk smaller than the heap has a whole free buddy, and
+   FALSE otherwise. */
+
+static int Checker_memIsValid(Chunk_T oHeapStart, Chunk_T oHeapEnd,
+   int *piFreeCount)
+{
+   Chunk_T oChunk;
+   Chunk_T oBuddy;
+   size_t uHeapBytes;
+
+   uHeapBytes = (size_t)((char*)oHeapEnd - (char*)oHeapStart);
+
+   /* Is the heap a whole block? */
+   if ((uHeapBytes & (uHeapBytes - 1)) != 0)
+   {
+      fprintf(stderr, "The heap size is not a power of two\n");
+      return FALSE;
+   }
+
+   *piFreeCount = 0;
+   for (oChunk = oHeapStart;
+        oChunk != NULL;
+        oChunk = Chunk_getNextInMem(oChunk, oHeapEnd))
+   {
+      /* Is the chunk valid? */
+      if (! Chunk_isValid(oChunk, oHeapStart, oHeapEnd))
+      {
+         fprintf(stderr, "Traversing memory detected a bad chunk\n");
+         return FALSE;
+      }
+
+      if (Chunk_getStatus(oChunk) != CHUNK_FREE)
+         continue;
+      (*piFreeCount)++;
+
+      /* Should the chunk have been merged with its buddy? */
+      if (Chunk_orderToBytes(Chunk_getOrder(oChunk)) == uHeapBytes)
+         continue;
+      oBuddy = Chunk_getBuddy(oChunk, oHeapStart);
+      if ((Chunk_getStatus(oBuddy) == CHUNK_FREE)
+         && (Chunk_getOrder(oBuddy) == Chunk_getOrder(oChunk)))
+      {
+         fprintf(stderr, "The heap contains free buddies\n");
+         return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Traverse oFreeList, the list of order iOrder, and add its length to
+   *piListCount, which may not exceed iMaxCount. Return TRUE if every
+   chunk in it is valid, free, of order iOrder and properly linked, and
+   FALSE otherwise. */
+
+static int Checker_listIsValid(Chunk_T oFreeList, int iOrder,
+   Chunk_T oHeapStart, Chunk_T oHeapEnd, int *piListCount,
+   int iMaxCount)
+{
+   Chunk_T oChunk;
+   Chunk_T oNextChunk;
+
+   /* Does the front of the list point to a previous chunk? */
+   if ((oFreeList != NULL) && (Chunk_getPrevInList(oFreeList) != NULL))
+   {
+      fprintf(stderr, "The front of a list has a previous chunk\n");
+      return FALSE;
+   }
+
+   for (oChunk = oFreeList;
+        oChunk != NULL;
+        oChunk = oNextChunk)
+   {
+      /* Has the traversal seen more chunks than are free? If so, some
+         list must have a cycle or share a chunk with another. */
+      (*piListCount)++;
+      if (*piListCount > iMaxCount)
+      {
+         fprintf(stderr, "A list has a cycle or a shared chunk\n");
+         return FALSE;
+      }
+
+      /* Is the chunk valid, free and of the list's order? */
+      if (! Chunk_isValid(oChunk, oHeapStart, oHeapEnd))
+      {
+         fprintf(stderr, "Traversing a list detected a bad chunk\n");
+         return FALSE;
+      }
+      if (Chunk_getStatus(oChunk) != CHUNK_FREE)
+      {
+         fprintf(stderr, "A list contains a chunk that is in use\n");
+         return FALSE;
+      }
+      if (Chunk_getOrder(oChunk) != iOrder)
+      {
+         fprintf(stderr, "A chunk is in the wrong list\n");
+         return FALSE;
+      }
+
+      /* Does the next chunk in the list point back to this one? */
+      oNextChunk = Chunk_getNextInList(oChunk);
+      if ((oNextChunk != NULL)
+         && (Chunk_getPrevInList(oNextChunk) != oChunk))
+      {
+         fprintf(stderr, "A list is misaligned\n");
+         return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return TRUE if ulOrderMap agrees with aoLists, and FALSE
+   otherwise. */
+
+static int Checker_mapIsValid(Chunk_T aoLists[], int iOrderCount,
+   unsigned long ulOrderMap)
+{
+   int iOrder;
+   int iBitSet;
+
+   for (iOrder = 0; iOrder < iOrderCount; iOrder++)
+   {
+      iBitSet = (int)((ulOrderMap >> iOrder) & 1UL);
+      if (iBitSet != (aoLists[iOrder] != NULL))
+      {
+         fprintf(stderr, "The order map is wrong\n");
+         return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Checker_isValid(Chunk_T oHeapStart, Chunk_T oHeapEnd,
+   Chunk_T aoLists[], int iOrderCount, unsigned long ulOrderMap)
+{
+   int iOrder;
+   int iMemCount = 0;
+   int iListCount = 0;
+
+   /* Do oHeapStart and oHeapEnd have non-NULL values? */
+   if (oHeapStart == NULL)
+   {
+      fprintf(stderr, "The heap start is uninitialized\n");
+      return FALSE;
+   }
+   if (oHeapEnd == NULL)
+   {
+      fprintf(stderr, "The heap end is uninitialized\n");
+      return FALSE;
+   }
+
+   /* Does the bitmap agree with the lists? */
+   if (! Checker_mapIsValid(aoLists, iOrderCount, ulOrderMap))
+      return FALSE;
+
+   /* Traverse memory. If the heap is empty, this finds no free chunks,
+      so the lists must be empty too. */
+   if (oHeapStart != oHeapEnd)
+      if (! Checker_memIsValid(oHeapStart, oHeapEnd, &iMemCount))
+         return FALSE;
+
+   /* Traverse the lists. */
+   for (iOrder = 0; iOrder < iOrderCount; iOrder++)
+      if (! Checker_listIsValid(aoLists[iOrder], iOrder, oHeapStart,
+         oHeapEnd, &iListCount, iMemCount))
+         return FALSE;
+
+   /* Is every free chunk in memory in some list? */
+   if (iMemCount != iListCount)
+   {
+      fprintf(stderr,
+         "Number of free chunks in the lists and memory not equal\n");
+      return FALSE;
+   }
+
+   return TRUE;
+}
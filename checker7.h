@@ -0,0 +1,22 @@
+/*--------------------------------------------------------------------*/
+/* checker7.h                                                         */
+/* Author: Isaac Wolfe and Isaac Hart                                 */
+/*--------------------------------------------------------------------*/
+
+#ifndef CHECKER7_INCLUDED
+#define CHECKER7_INCLUDED
+
+#include "chunk7.h"
+
+/* Return 1 (TRUE) if the heap is in a valid state, or 0 (FALSE)
+   otherwise. The heap is defined by parameters oHeapStart (the address
+   of the start of the heap), oHeapEnd (the address immediately
+   beyond the end of the heap), aoLists (an array of iOrderCount free
+   lists, list i holding the free chunks of order i), and ulOrderMap (a
+   word with one bit per order, set iff the order's list is
+   non-empty). */
+
+int Checker_isValid(Chunk_T oHeapStart, Chunk_T oHeapEnd,
+   Chunk_T aoLists[], int iOrderCount, unsigned long ulOrderMap);
+
+#endif
@@ -5,6 +5,7 @@
 
 #include "chunk5.h"
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <assert.h>
 
@@ -16,22 +17,57 @@
    
 struct Chunk
 {
-   /* The number of units in the Chunk. The low-order bit
-      stores the Chunk's status. */
+   /* The number of units in the Chunk. In a header, the low-order
+      bit stores the Chunk's status and the next bit the status of
+      the previous Chunk in memory. */
    size_t uUnits;
 
    /* The address of an adjacent Chunk. */
    Chunk_T oAdjacentChunk;
 };
 
+/* The bits of a header's uUnits that hold the Chunk's status, the
+   previous Chunk's status, whether the Chunk is mapped, whether it is
+   purged and whether it is zero, and the number of bits that they
+   take. */
+enum {STATUS_BIT = 1, PREV_STATUS_BIT = 2, MAPPED_BIT = 4,
+   PURGED_BIT = 8, ZERO_BIT = 16, FLAG_BITS = 5};
+
+/*--------------------------------------------------------------------*/
+
+Chunk_T Chunk_startHeap(void *pv)
+{
+   size_t uPad;
+
+   uPad = (sizeof(struct Chunk)
+      - ((uintptr_t)pv % sizeof(struct Chunk))) % sizeof(struct Chunk);
+   return (Chunk_T)((char*)pv + uPad);
+}
+
+/*--------------------------------------------------------------------*/
+
+Chunk_T Chunk_startSegment(void *pv, size_t uBytes)
+{
+   assert(uBytes > 0);
+
+   /* Chunks can be anywhere that does not wrap around. */
+   if ((uintptr_t)pv + uBytes < (uintptr_t)pv)
+      return NULL;
+   return Chunk_startHeap(pv);
+}
+
 /*--------------------------------------------------------------------*/
 
 size_t Chunk_bytesToUnits(size_t uBytes)
 {
    size_t uUnits;
+
+   assert(uBytes > 0);
+
+   if (uBytes > Chunk_unitsToBytes(MAX_UNITS_PER_CHUNK - 1))
+      return 0;
    uUnits = ((uBytes - 1) / sizeof(struct Chunk)) + 1;
    uUnits++;  /* Allow room for a header. */
-   uUnits++;  /* Allow room for a footer. */
    return uUnits;
 }
 
@@ -66,7 +102,7 @@ enum ChunkStatus Chunk_getStatus(Chunk_T oChunk)
 {
    assert(oChunk != NULL);
 
-   return oChunk->uUnits & 1UL;
+   return oChunk->uUnits & STATUS_BIT;
 }
 
 /*--------------------------------------------------------------------*/
@@ -76,8 +112,122 @@ void Chunk_setStatus(Chunk_T oChunk, enum ChunkStatus eStatus)
    assert(oChunk != NULL);
    assert((eStatus == CHUNK_FREE) || (eStatus == CHUNK_INUSE));
 
-   oChunk->uUnits &= ~1UL;
-   oChunk->uUnits |= eStatus;
+   oChunk->uUnits &= ~(size_t)STATUS_BIT;
+   oChunk->uUnits |= (size_t)eStatus;
+
+   /* A free Chunk needs a footer. */
+   if (eStatus == CHUNK_FREE)
+      (oChunk + Chunk_getUnits(oChunk) - 1)->uUnits =
+         Chunk_getUnits(oChunk);
+}
+
+/*--------------------------------------------------------------------*/
+
+enum ChunkStatus Chunk_getPrevStatus(Chunk_T oChunk)
+{
+   assert(oChunk != NULL);
+
+   if ((oChunk->uUnits & PREV_STATUS_BIT) != 0)
+      return CHUNK_INUSE;
+   return CHUNK_FREE;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Chunk_setPrevStatus(Chunk_T oChunk, enum ChunkStatus eStatus)
+{
+   assert(oChunk != NULL);
+   assert((eStatus == CHUNK_FREE) || (eStatus == CHUNK_INUSE));
+
+   if (eStatus == CHUNK_INUSE)
+      oChunk->uUnits |= PREV_STATUS_BIT;
+   else
+      oChunk->uUnits &= ~(size_t)PREV_STATUS_BIT;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Chunk_isMapped(Chunk_T oChunk)
+{
+   assert(oChunk != NULL);
+
+   return (oChunk->uUnits & MAPPED_BIT) != 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Chunk_setMapped(Chunk_T oChunk, int bMapped)
+{
+   assert(oChunk != NULL);
+
+   if (bMapped)
+      oChunk->uUnits |= MAPPED_BIT;
+   else
+      oChunk->uUnits &= ~(size_t)MAPPED_BIT;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Chunk_isPurged(Chunk_T oChunk)
+{
+   assert(oChunk != NULL);
+
+   return (oChunk->uUnits & PURGED_BIT) != 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Chunk_setPurged(Chunk_T oChunk, int bPurged)
+{
+   assert(oChunk != NULL);
+
+   if (bPurged)
+      oChunk->uUnits |= PURGED_BIT;
+   else
+      oChunk->uUnits &= ~(size_t)PURGED_BIT;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Chunk_isZero(Chunk_T oChunk)
+{
+   assert(oChunk != NULL);
+
+   return (oChunk->uUnits & ZERO_BIT) != 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Chunk_setZero(Chunk_T oChunk, int bZero)
+{
+   assert(oChunk != NULL);
+
+   if (bZero)
+      oChunk->uUnits |= ZERO_BIT;
+   else
+      oChunk->uUnits &= ~(size_t)ZERO_BIT;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Chunk_getFreeTime(Chunk_T oChunk)
+{
+   assert(oChunk != NULL);
+   assert(Chunk_getStatus(oChunk) == CHUNK_FREE);
+   assert(Chunk_getUnits(oChunk) >= 3);
+
+   return *(size_t*)Chunk_toPayload(oChunk);
+}
+
+/*--------------------------------------------------------------------*/
+
+void Chunk_setFreeTime(Chunk_T oChunk, size_t uTime)
+{
+   assert(oChunk != NULL);
+   assert(Chunk_getStatus(oChunk) == CHUNK_FREE);
+   assert(Chunk_getUnits(oChunk) >= 3);
+
+   *(size_t*)Chunk_toPayload(oChunk) = uTime;
 }
 
 /*--------------------------------------------------------------------*/
@@ -86,7 +236,7 @@ size_t Chunk_getUnits(Chunk_T oChunk)
 {
    assert(oChunk != NULL);
 
-   return oChunk->uUnits >> 1;
+   return oChunk->uUnits >> FLAG_BITS;
 }
 
 /*--------------------------------------------------------------------*/
@@ -95,13 +245,16 @@ void Chunk_setUnits(Chunk_T oChunk, size_t uUnits)
 {
    assert(oChunk != NULL);
    assert(uUnits >= MIN_UNITS_PER_CHUNK);
+   assert(uUnits <= MAX_UNITS_PER_CHUNK);
 
    /* Set the Units in oChunk's header. */
-   oChunk->uUnits &= 1UL;
-   oChunk->uUnits |= uUnits << 1UL;
+   oChunk->uUnits &= (size_t)(STATUS_BIT | PREV_STATUS_BIT | MAPPED_BIT
+      | PURGED_BIT | ZERO_BIT);
+   oChunk->uUnits |= uUnits << FLAG_BITS;
 
-   /* Set the Units in oChunk's footer. */
-   (oChunk + uUnits - 1)->uUnits = uUnits;
+   /* Set the Units in oChunk's footer, if it has one. */
+   if (Chunk_getStatus(oChunk) == CHUNK_FREE)
+      (oChunk + uUnits - 1)->uUnits = uUnits;
 }
 
 /*--------------------------------------------------------------------*/
@@ -142,6 +295,42 @@ void Chunk_setPrevInList(Chunk_T oChunk, Chunk_T oPrevChunk)
 
 /*--------------------------------------------------------------------*/
 
+Chunk_T Chunk_getLeftInTree(Chunk_T oChunk)
+{
+   assert(oChunk != NULL);
+
+   return oChunk->oAdjacentChunk;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Chunk_setLeftInTree(Chunk_T oChunk, Chunk_T oLeftChunk)
+{
+   assert(oChunk != NULL);
+
+   oChunk->oAdjacentChunk = oLeftChunk;
+}
+
+/*--------------------------------------------------------------------*/
+
+Chunk_T Chunk_getRightInTree(Chunk_T oChunk)
+{
+   assert(oChunk != NULL);
+
+   return (oChunk + Chunk_getUnits(oChunk) - 1)->oAdjacentChunk;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Chunk_setRightInTree(Chunk_T oChunk, Chunk_T oRightChunk)
+{
+   assert(oChunk != NULL);
+
+   (oChunk + Chunk_getUnits(oChunk) - 1)->oAdjacentChunk = oRightChunk;
+}
+
+/*--------------------------------------------------------------------*/
+
 Chunk_T Chunk_getNextInMem(Chunk_T oChunk, Chunk_T oHeapEnd)
 {
    Chunk_T oNextChunk;
@@ -171,6 +360,7 @@ Chunk_T Chunk_getPrevInMem(Chunk_T oChunk, Chunk_T oHeapStart)
    if (oChunk == oHeapStart)
       return NULL;
 
+   assert(Chunk_getPrevStatus(oChunk) == CHUNK_FREE);
    oPrevChunk = oChunk - ((oChunk - 1)->uUnits);
    assert(oPrevChunk >= oHeapStart);
 
@@ -179,7 +369,8 @@ Chunk_T Chunk_getPrevInMem(Chunk_T oChunk, Chunk_T oHeapStart)
 
 /*--------------------------------------------------------------------*/
 
-/* Return the number of units as stored in oChunk's footer. */
+/* Return the number of units as stored in oChunk's footer, which
+   only a free Chunk has. */
 
 static size_t Chunk_getFooterUnits(Chunk_T oChunk)
 {
@@ -217,7 +408,12 @@ int Chunk_isValid(Chunk_T oChunk,
    {  fprintf(stderr, "A chunk has too few units\n");
       return 0;
    }
-   if (Chunk_getUnits(oChunk) != Chunk_getFooterUnits(oChunk))
+   if (Chunk_getUnits(oChunk) > MAX_UNITS_PER_CHUNK)
+   {  fprintf(stderr, "A chunk has too many units\n");
+      return 0;
+   }
+   if ((Chunk_getStatus(oChunk) == CHUNK_FREE)
+      && (Chunk_getUnits(oChunk) != Chunk_getFooterUnits(oChunk)))
    {  fprintf(stderr, "A chunk has inconsistent header/footer sizes\n");
       return 0;
    }
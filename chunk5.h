@@ -13,11 +13,26 @@ enum ChunkStatus {CHUNK_FREE, CHUNK_INUSE};
 
 /* A Chunk is a sequence of Units.  The first Unit is a header that
    indicates the number of Units in the Chunk, whether the Chunk is
-   free, and, if the Chunk is free, a pointer to the next Chunk in the
-   free list. The last Unit is a footer that indicates the number of
-   Units in the Chunk and, if the Chunk is free, a pointer to the
-   previous Chunk in the free list. The Units between the header and
-   footer are the payload. */
+   free, whether the previous Chunk in memory is free, whether the
+   Chunk is mapped (that is, alone in memory obtained for it alone
+   rather than part of the heap), whether the Chunk is free and its
+   pages have been returned to the OS, whether the Chunk is known to
+   be zero, and, if the Chunk is free, a pointer to the next Chunk in
+   the free list. An in-use Chunk that is held in a fast bin or in the
+   zero pool uses the same pointer to link it in that list. The Units
+   after the header are the payload. If the Chunk is free, its last
+   Unit is instead a footer that indicates the number of Units in the
+   Chunk and a pointer to the previous Chunk in the free list; an
+   in-use Chunk has no footer, so the previous Chunk in memory can be
+   found only if it is free. A free Chunk that is kept in a tree
+   rather than a free list uses the same two addresses as the left and
+   right children of its tree node. A free Chunk of at least three
+   Units can record, in the Unit after its header, the time at which
+   it was freed.
+
+   chunk5.c and chunk5compact.c implement this interface with
+   different layouts. A module that is linked with chunk5compact.c
+   must be compiled with CHUNK5_COMPACT defined. */
 
 typedef struct Chunk *Chunk_T;
 
@@ -25,11 +40,51 @@ typedef struct Chunk *Chunk_T;
 
 /* The minimum number of units that a Chunk can contain. */
 
-static const size_t MIN_UNITS_PER_CHUNK = 3;
+static const size_t MIN_UNITS_PER_CHUNK = 2;
+
+/* The maximum number of units that a Chunk of the heap can contain.
+   A mapped Chunk can contain more. */
+
+#ifdef CHUNK5_COMPACT
+static const size_t MAX_UNITS_PER_CHUNK = ((size_t)1 << 27) - 1;
+#else
+static const size_t MAX_UNITS_PER_CHUNK = ~(size_t)0 >> 6;
+#endif
+
+/* The number of bytes past a multiple of the unit size at which every
+   Chunk starts. */
+
+#ifdef CHUNK5_COMPACT
+static const size_t CHUNK_START_OFFSET = 8;
+#else
+static const size_t CHUNK_START_OFFSET = 0;
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* Return the first address at or after pv at which a heap can start,
+   so that payloads are properly aligned. This must be called once,
+   before any other function, with the address of the memory in which
+   the heap will start. */
+
+Chunk_T Chunk_startHeap(void *pv);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the first address at or after pv at which Chunks can start
+   in the uBytes bytes of memory at pv, which are to hold a further
+   part of the heap, or NULL if Chunks there could not be represented.
+   Chunk_startHeap() must have been called. */
+
+Chunk_T Chunk_startSegment(void *pv, size_t uBytes);
 
 /*--------------------------------------------------------------------*/
 
-/* Translate uBytes, a number of bytes, to units. Return the result. */
+/* Translate uBytes, a number of bytes, to the number of units of a
+   Chunk whose payload can hold them. Return the result, or 0 if no
+   Chunk can hold uBytes bytes. The result can exceed
+   MAX_UNITS_PER_CHUNK, in which case only a mapped Chunk (see
+   large5.h) can hold uBytes bytes. */
 
 size_t Chunk_bytesToUnits(size_t uBytes);
 
@@ -59,19 +114,94 @@ enum ChunkStatus Chunk_getStatus(Chunk_T oChunk);
 
 /*--------------------------------------------------------------------*/
 
-/* Set the status of oChunk to eStatus. */
+/* Set the status of oChunk to eStatus. If eStatus is CHUNK_FREE, also
+   write oChunk's footer, so oChunk's number of units must be set. */
 
 void Chunk_setStatus(Chunk_T oChunk, enum ChunkStatus eStatus);
 
 /*--------------------------------------------------------------------*/
 
+/* Return the status of the Chunk before oChunk in memory, as recorded
+   in oChunk's header. A Chunk at the start of the heap records that
+   its (nonexistent) previous Chunk is in use. */
+
+enum ChunkStatus Chunk_getPrevStatus(Chunk_T oChunk);
+
+/*--------------------------------------------------------------------*/
+
+/* Record eStatus as the status of the Chunk before oChunk in
+   memory. */
+
+void Chunk_setPrevStatus(Chunk_T oChunk, enum ChunkStatus eStatus);
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) if oChunk is mapped, or 0 (FALSE) otherwise. */
+
+int Chunk_isMapped(Chunk_T oChunk);
+
+/*--------------------------------------------------------------------*/
+
+/* Record that oChunk is mapped if bMapped is 1 (TRUE), or that it is
+   not if bMapped is 0 (FALSE). */
+
+void Chunk_setMapped(Chunk_T oChunk, int bMapped);
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) if oChunk is marked purged, or 0 (FALSE)
+   otherwise. */
+
+int Chunk_isPurged(Chunk_T oChunk);
+
+/*--------------------------------------------------------------------*/
+
+/* Mark oChunk as purged if bPurged is 1 (TRUE), or as not purged if
+   bPurged is 0 (FALSE). */
+
+void Chunk_setPurged(Chunk_T oChunk, int bPurged);
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) if oChunk is marked zero, or 0 (FALSE) otherwise. A
+   Chunk marked zero holds only zeros apart from its header, the first
+   Unit of its payload and its last Unit, where a free Chunk records
+   its time, its footer and its links. Only free Chunks and Chunks just
+   allocated are reliably marked. */
+
+int Chunk_isZero(Chunk_T oChunk);
+
+/*--------------------------------------------------------------------*/
+
+/* Mark oChunk as zero if bZero is 1 (TRUE), or as not zero if bZero is
+   0 (FALSE). */
+
+void Chunk_setZero(Chunk_T oChunk, int bZero);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the time recorded in oChunk, which must be free and have at
+   least three units. */
+
+size_t Chunk_getFreeTime(Chunk_T oChunk);
+
+/*--------------------------------------------------------------------*/
+
+/* Record uTime in oChunk, which must be free and have at least three
+   units. */
+
+void Chunk_setFreeTime(Chunk_T oChunk, size_t uTime);
+
+/*--------------------------------------------------------------------*/
+
 /* Return oChunk's number of units. */
 
 size_t Chunk_getUnits(Chunk_T oChunk);
 
 /*--------------------------------------------------------------------*/
 
-/* Set oChunk's number of units to uUnits. */
+/* Set oChunk's number of units to uUnits, and write oChunk's footer if
+   oChunk is free. */
 
 void Chunk_setUnits(Chunk_T oChunk, size_t uUnits);
 
@@ -103,6 +233,32 @@ void Chunk_setPrevInList(Chunk_T oChunk, Chunk_T oPrevChunk);
 
 /*--------------------------------------------------------------------*/
 
+/* Return oChunk's left child in the tree, or NULL if there is no
+   left child. */
+
+Chunk_T Chunk_getLeftInTree(Chunk_T oChunk);
+
+/*--------------------------------------------------------------------*/
+
+/* Set oChunk's left child in the tree to oLeftChunk. */
+
+void Chunk_setLeftInTree(Chunk_T oChunk, Chunk_T oLeftChunk);
+
+/*--------------------------------------------------------------------*/
+
+/* Return oChunk's right child in the tree, or NULL if there is no
+   right child. */
+
+Chunk_T Chunk_getRightInTree(Chunk_T oChunk);
+
+/*--------------------------------------------------------------------*/
+
+/* Set oChunk's right child in the tree to oRightChunk. */
+
+void Chunk_setRightInTree(Chunk_T oChunk, Chunk_T oRightChunk);
+
+/*--------------------------------------------------------------------*/
+
 /* Return oChunk's next Chunk in memory, or NULL if there is no
    next Chunk. Use oHeapEnd to determine if there is no next
    Chunk. oChunk's number of units must be set properly for this
@@ -114,8 +270,9 @@ Chunk_T Chunk_getNextInMem(Chunk_T oChunk, Chunk_T oHeapEnd);
 
 /* Return oChunk's previous Chunk in memory, or NULL if there is no
    previous Chunk. Use oHeapStart to determine if there is no
-   previous Chunk. The previous Chunk's number of units must be set
-   properly for this function to work. */
+   previous Chunk. The previous Chunk must be free, as recorded in
+   oChunk's header, and its footer must be set properly for this
+   function to work. */
 
 Chunk_T Chunk_getPrevInMem(Chunk_T oChunk, Chunk_T oHeapStart);
 
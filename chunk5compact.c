@@ -0,0 +1,516 @@
+/*--------------------------------------------------------------------*/
+/* chunk5compact.c                                                    */
+/* Author: Isaac Wolfe and Isaac Hart                                 */
+/*--------------------------------------------------------------------*/
+
+#include "chunk5.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <assert.h>
+
+#ifndef CHUNK5_COMPACT
+#error "Modules linked with chunk5compact.c need CHUNK5_COMPACT"
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* Physically a Chunk is a structure consisting of a number of units
+   and the offset of an adjacent Chunk, each in 32 bits, so that a
+   header or footer takes half a unit. A unit is still 16 bytes, so
+   that payloads stay aligned: every Chunk starts 8 bytes past a
+   multiple of 16, its payload starts right after its header, and a
+   free Chunk's footer is its last 8 bytes. Offsets count units from
+   a base address, plus one so that 0 can stand for NULL; the heap can
+   thus span nearly 2^32 units, or 64 GB. The base is half that below
+   the start of the heap, so that further parts of the heap, which the
+   OS may place below or above the first, can be reached either way.
+   A further part that the OS places beyond that reach, past other
+   large reservations, cannot hold Chunks, so the heap cannot grow
+   there. */
+
+struct Chunk
+{
+   /* The number of units in the Chunk. In a header, the low-order
+      bit stores the Chunk's status and the next bit the status of
+      the previous Chunk in memory. */
+   uint32_t uiUnits;
+
+   /* The offset of an adjacent Chunk, or 0 for none. */
+   uint32_t uiAdjacentChunk;
+};
+
+/* The bits of a header's uiUnits that hold the Chunk's status, the
+   previous Chunk's status, whether the Chunk is mapped, whether it is
+   purged and whether it is zero, and the number of bits that they
+   take. */
+enum {STATUS_BIT = 1, PREV_STATUS_BIT = 2, MAPPED_BIT = 4,
+   PURGED_BIT = 8, ZERO_BIT = 16, FLAG_BITS = 5};
+
+/* The number of bytes in a unit. Every Chunk starts
+   CHUNK_START_OFFSET bytes past a multiple of UNIT_BYTES. */
+enum {UNIT_BYTES = 16};
+
+/*--------------------------------------------------------------------*/
+
+/* The base address, from which offsets are counted. */
+static Chunk_T oBase = NULL;
+
+/*--------------------------------------------------------------------*/
+
+/* Return the offset of oChunk, which may be NULL. */
+
+static uint32_t Chunk_toOffset(Chunk_T oChunk)
+{
+   size_t uOffset;
+
+   if (oChunk == NULL)
+      return 0;
+
+   assert(oBase != NULL);
+   assert(oChunk >= oBase);
+
+   uOffset = (size_t)((char*)oChunk - (char*)oBase) / UNIT_BYTES;
+   assert(uOffset < (size_t)UINT32_MAX);
+   return (uint32_t)(uOffset + 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the Chunk whose offset is uiOffset, or NULL if uiOffset
+   is 0. */
+
+static Chunk_T Chunk_fromOffset(uint32_t uiOffset)
+{
+   if (uiOffset == 0)
+      return NULL;
+
+   return (Chunk_T)((char*)oBase
+      + ((size_t)(uiOffset - 1) * UNIT_BYTES));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the address of the Chunk that starts uUnits units after
+   oChunk. */
+
+static Chunk_T Chunk_advance(Chunk_T oChunk, size_t uUnits)
+{
+   return (Chunk_T)((char*)oChunk + (uUnits * UNIT_BYTES));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the address of oChunk's footer, which only a free Chunk
+   has. */
+
+static Chunk_T Chunk_getFooter(Chunk_T oChunk)
+{
+   return Chunk_advance(oChunk, Chunk_getUnits(oChunk)) - 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+Chunk_T Chunk_startHeap(void *pv)
+{
+   const size_t HALF_REACH_BYTES =
+      ((size_t)UINT32_MAX / 2) * UNIT_BYTES;
+   Chunk_T oStart;
+   size_t uPad;
+
+   uPad = (UNIT_BYTES + CHUNK_START_OFFSET
+      - ((uintptr_t)pv % UNIT_BYTES)) % UNIT_BYTES;
+   oStart = (Chunk_T)((char*)pv + uPad);
+   if ((uintptr_t)oStart > HALF_REACH_BYTES)
+      oBase = (Chunk_T)((char*)oStart - HALF_REACH_BYTES);
+   else
+      oBase = oStart;
+   return oStart;
+}
+
+/*--------------------------------------------------------------------*/
+
+Chunk_T Chunk_startSegment(void *pv, size_t uBytes)
+{
+   Chunk_T oStart;
+   size_t uPad;
+
+   assert(oBase != NULL);
+   assert(uBytes > 0);
+
+   /* Every Chunk must lie where an offset from the base can reach
+      it. */
+   uPad = (UNIT_BYTES + CHUNK_START_OFFSET
+      - ((uintptr_t)pv % UNIT_BYTES)) % UNIT_BYTES;
+   oStart = (Chunk_T)((char*)pv + uPad);
+   if ((oStart < oBase)
+      || ((size_t)((char*)pv + uBytes - (char*)oBase) / UNIT_BYTES
+         >= (size_t)UINT32_MAX))
+      return NULL;
+   return oStart;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Chunk_bytesToUnits(size_t uBytes)
+{
+   size_t uUnits;
+
+   assert(uBytes > 0);
+
+   /* Only a mapped Chunk can hold more than MAX_UNITS_PER_CHUNK units,
+      so refuse only a size that no mapping could hold. */
+   if (uBytes > ~(size_t)0 >> 2)
+      return 0;
+
+   /* Allow room for a header. */
+   uUnits = ((uBytes + sizeof(struct Chunk) - 1) / UNIT_BYTES) + 1;
+   if (uUnits < MIN_UNITS_PER_CHUNK)
+      uUnits = MIN_UNITS_PER_CHUNK;
+   return uUnits;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Chunk_unitsToBytes(size_t uUnits)
+{
+   return uUnits * UNIT_BYTES;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *Chunk_toPayload(Chunk_T oChunk)
+{
+   assert(oChunk != NULL);
+
+   return (void*)(oChunk + 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+Chunk_T Chunk_fromPayload(void *pv)
+{
+   assert(pv != NULL);
+
+   return (Chunk_T)pv - 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+enum ChunkStatus Chunk_getStatus(Chunk_T oChunk)
+{
+   assert(oChunk != NULL);
+
+   return oChunk->uiUnits & STATUS_BIT;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Chunk_setStatus(Chunk_T oChunk, enum ChunkStatus eStatus)
+{
+   assert(oChunk != NULL);
+   assert((eStatus == CHUNK_FREE) || (eStatus == CHUNK_INUSE));
+
+   oChunk->uiUnits &= ~(uint32_t)STATUS_BIT;
+   oChunk->uiUnits |= (uint32_t)eStatus;
+
+   /* A free Chunk needs a footer. */
+   if (eStatus == CHUNK_FREE)
+      Chunk_getFooter(oChunk)->uiUnits =
+         (uint32_t)Chunk_getUnits(oChunk);
+}
+
+/*--------------------------------------------------------------------*/
+
+enum ChunkStatus Chunk_getPrevStatus(Chunk_T oChunk)
+{
+   assert(oChunk != NULL);
+
+   if ((oChunk->uiUnits & PREV_STATUS_BIT) != 0)
+      return CHUNK_INUSE;
+   return CHUNK_FREE;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Chunk_setPrevStatus(Chunk_T oChunk, enum ChunkStatus eStatus)
+{
+   assert(oChunk != NULL);
+   assert((eStatus == CHUNK_FREE) || (eStatus == CHUNK_INUSE));
+
+   if (eStatus == CHUNK_INUSE)
+      oChunk->uiUnits |= PREV_STATUS_BIT;
+   else
+      oChunk->uiUnits &= ~(uint32_t)PREV_STATUS_BIT;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Chunk_isMapped(Chunk_T oChunk)
+{
+   assert(oChunk != NULL);
+
+   return (oChunk->uiUnits & MAPPED_BIT) != 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Chunk_setMapped(Chunk_T oChunk, int bMapped)
+{
+   assert(oChunk != NULL);
+
+   if (bMapped)
+      oChunk->uiUnits |= MAPPED_BIT;
+   else
+      oChunk->uiUnits &= ~(uint32_t)MAPPED_BIT;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Chunk_isPurged(Chunk_T oChunk)
+{
+   assert(oChunk != NULL);
+
+   return (oChunk->uiUnits & PURGED_BIT) != 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Chunk_setPurged(Chunk_T oChunk, int bPurged)
+{
+   assert(oChunk != NULL);
+
+   if (bPurged)
+      oChunk->uiUnits |= PURGED_BIT;
+   else
+      oChunk->uiUnits &= ~(uint32_t)PURGED_BIT;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Chunk_isZero(Chunk_T oChunk)
+{
+   assert(oChunk != NULL);
+
+   return (oChunk->uiUnits & ZERO_BIT) != 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Chunk_setZero(Chunk_T oChunk, int bZero)
+{
+   assert(oChunk != NULL);
+
+   if (bZero)
+      oChunk->uiUnits |= ZERO_BIT;
+   else
+      oChunk->uiUnits &= ~(uint32_t)ZERO_BIT;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Chunk_getFreeTime(Chunk_T oChunk)
+{
+   assert(oChunk != NULL);
+   assert(Chunk_getStatus(oChunk) == CHUNK_FREE);
+   assert(Chunk_getUnits(oChunk) >= 3);
+
+   return *(size_t*)Chunk_toPayload(oChunk);
+}
+
+/*--------------------------------------------------------------------*/
+
+void Chunk_setFreeTime(Chunk_T oChunk, size_t uTime)
+{
+   assert(oChunk != NULL);
+   assert(Chunk_getStatus(oChunk) == CHUNK_FREE);
+   assert(Chunk_getUnits(oChunk) >= 3);
+
+   *(size_t*)Chunk_toPayload(oChunk) = uTime;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Chunk_getUnits(Chunk_T oChunk)
+{
+   assert(oChunk != NULL);
+
+   return (size_t)(oChunk->uiUnits >> FLAG_BITS);
+}
+
+/*--------------------------------------------------------------------*/
+
+void Chunk_setUnits(Chunk_T oChunk, size_t uUnits)
+{
+   assert(oChunk != NULL);
+   assert(uUnits >= MIN_UNITS_PER_CHUNK);
+   assert(uUnits <= MAX_UNITS_PER_CHUNK);
+
+   /* Set the Units in oChunk's header. */
+   oChunk->uiUnits &= (uint32_t)(STATUS_BIT | PREV_STATUS_BIT
+      | MAPPED_BIT | PURGED_BIT | ZERO_BIT);
+   oChunk->uiUnits |= (uint32_t)(uUnits << FLAG_BITS);
+
+   /* Set the Units in oChunk's footer, if it has one. */
+   if (Chunk_getStatus(oChunk) == CHUNK_FREE)
+      Chunk_getFooter(oChunk)->uiUnits = (uint32_t)uUnits;
+}
+
+/*--------------------------------------------------------------------*/
+
+Chunk_T Chunk_getNextInList(Chunk_T oChunk)
+{
+   assert(oChunk != NULL);
+
+   return Chunk_fromOffset(oChunk->uiAdjacentChunk);
+}
+
+/*--------------------------------------------------------------------*/
+
+void Chunk_setNextInList(Chunk_T oChunk, Chunk_T oNextChunk)
+{
+   assert(oChunk != NULL);
+
+   oChunk->uiAdjacentChunk = Chunk_toOffset(oNextChunk);
+}
+
+/*--------------------------------------------------------------------*/
+
+Chunk_T Chunk_getPrevInList(Chunk_T oChunk)
+{
+   assert(oChunk != NULL);
+
+   return Chunk_fromOffset(Chunk_getFooter(oChunk)->uiAdjacentChunk);
+}
+
+/*--------------------------------------------------------------------*/
+
+void Chunk_setPrevInList(Chunk_T oChunk, Chunk_T oPrevChunk)
+{
+   assert(oChunk != NULL);
+
+   Chunk_getFooter(oChunk)->uiAdjacentChunk =
+      Chunk_toOffset(oPrevChunk);
+}
+
+/*--------------------------------------------------------------------*/
+
+Chunk_T Chunk_getLeftInTree(Chunk_T oChunk)
+{
+   assert(oChunk != NULL);
+
+   return Chunk_fromOffset(oChunk->uiAdjacentChunk);
+}
+
+/*--------------------------------------------------------------------*/
+
+void Chunk_setLeftInTree(Chunk_T oChunk, Chunk_T oLeftChunk)
+{
+   assert(oChunk != NULL);
+
+   oChunk->uiAdjacentChunk = Chunk_toOffset(oLeftChunk);
+}
+
+/*--------------------------------------------------------------------*/
+
+Chunk_T Chunk_getRightInTree(Chunk_T oChunk)
+{
+   assert(oChunk != NULL);
+
+   return Chunk_fromOffset(Chunk_getFooter(oChunk)->uiAdjacentChunk);
+}
+
+/*--------------------------------------------------------------------*/
+
+void Chunk_setRightInTree(Chunk_T oChunk, Chunk_T oRightChunk)
+{
+   assert(oChunk != NULL);
+
+   Chunk_getFooter(oChunk)->uiAdjacentChunk =
+      Chunk_toOffset(oRightChunk);
+}
+
+/*--------------------------------------------------------------------*/
+
+Chunk_T Chunk_getNextInMem(Chunk_T oChunk, Chunk_T oHeapEnd)
+{
+   Chunk_T oNextChunk;
+
+   assert(oChunk != NULL);
+   assert(oHeapEnd != NULL);
+   assert(oChunk < oHeapEnd);
+
+   oNextChunk = Chunk_advance(oChunk, Chunk_getUnits(oChunk));
+   assert(oNextChunk <= oHeapEnd);
+
+   if (oNextChunk == oHeapEnd)
+      return NULL;
+   return oNextChunk;
+}
+
+/*--------------------------------------------------------------------*/
+
+Chunk_T Chunk_getPrevInMem(Chunk_T oChunk, Chunk_T oHeapStart)
+{
+   Chunk_T oPrevChunk;
+
+   assert(oChunk != NULL);
+   assert(oHeapStart != NULL);
+   assert(oChunk >= oHeapStart);
+
+   if (oChunk == oHeapStart)
+      return NULL;
+
+   assert(Chunk_getPrevStatus(oChunk) == CHUNK_FREE);
+   oPrevChunk = (Chunk_T)((char*)oChunk
+      - Chunk_unitsToBytes((oChunk - 1)->uiUnits));
+   assert(oPrevChunk >= oHeapStart);
+
+   return oPrevChunk;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Chunk_isValid(Chunk_T oChunk,
+                  Chunk_T oHeapStart, Chunk_T oHeapEnd)
+{
+   size_t uUnits;
+
+   assert(oChunk != NULL);
+   assert(oHeapStart != NULL);
+   assert(oHeapEnd != NULL);
+
+   uUnits = Chunk_getUnits(oChunk);
+
+   if (oChunk < oHeapStart)
+   {  fprintf(stderr, "A chunk starts before the heap start\n");
+      return 0;
+   }
+   if (oChunk >= oHeapEnd)
+   {  fprintf(stderr, "A chunk starts after the heap end\n");
+      return 0;
+   }
+   if ((size_t)((char*)oChunk - (char*)oHeapStart) % UNIT_BYTES != 0)
+   {  fprintf(stderr, "A chunk is not at a unit boundary\n");
+      return 0;
+   }
+   if (Chunk_unitsToBytes(uUnits)
+      > (size_t)((char*)oHeapEnd - (char*)oChunk))
+   {  fprintf(stderr, "A chunk ends after the heap end\n");
+      return 0;
+   }
+   if (uUnits == 0)
+   {  fprintf(stderr, "A chunk has zero units\n");
+      return 0;
+   }
+   if (uUnits < MIN_UNITS_PER_CHUNK)
+   {  fprintf(stderr, "A chunk has too few units\n");
+      return 0;
+   }
+   if ((Chunk_getStatus(oChunk) == CHUNK_FREE)
+      && (uUnits != Chunk_getFooter(oChunk)->uiUnits))
+   {  fprintf(stderr, "A chunk has inconsistent header/footer sizes\n");
+      return 0;
+   }
+   return 1;
+}
@@ -0,0 +1,227 @@
+/*--------------------------------------------------------------------*/
+/* chunk7.c                                                           */
+/* Author: Isaac Wolfe and Isaac Hart                                 */
+/*--------------------------------------------------------------------*/
+
+#include "chunk7.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <limits.h>
+#include <assert.h>
+
+/*--------------------------------------------------------------------*/
+
+/* Physically a Chunk is a structure consisting of an order and an
+   address. Logically a Chunk consists of 2^order bytes, the first
+   two such structures of which hold its metadata. */
+
+struct Chunk
+{
+   /* The order of the Chunk. The low-order bit stores the Chunk's
+      status. */
+   size_t uOrder;
+
+   /* The address of an adjacent Chunk in the free list. */
+   Chunk_T oAdjacentChunk;
+};
+
+/*--------------------------------------------------------------------*/
+
+int Chunk_bytesToOrder(size_t uBytes)
+{
+   int iOrder = MIN_ORDER;
+
+   /* Allow room for a header. */
+   if (uBytes > ~(size_t)0 - sizeof(struct Chunk))
+      return 0;
+   uBytes += sizeof(struct Chunk);
+
+   while (((size_t)1 << iOrder) < uBytes)
+   {
+      iOrder++;
+      if (iOrder >= (int)(sizeof(size_t) * CHAR_BIT))
+         return 0;
+   }
+   return iOrder;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Chunk_orderToBytes(int iOrder)
+{
+   assert(iOrder >= MIN_ORDER);
+   assert(iOrder < (int)(sizeof(size_t) * CHAR_BIT));
+
+   return (size_t)1 << iOrder;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *Chunk_toPayload(Chunk_T oChunk)
+{
+   assert(oChunk != NULL);
+
+   return (void*)(oChunk + 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+Chunk_T Chunk_fromPayload(void *pv)
+{
+   assert(pv != NULL);
+
+   return (Chunk_T)pv - 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+enum ChunkStatus Chunk_getStatus(Chunk_T oChunk)
+{
+   assert(oChunk != NULL);
+
+   return oChunk->uOrder & 1UL;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Chunk_setStatus(Chunk_T oChunk, enum ChunkStatus eStatus)
+{
+   assert(oChunk != NULL);
+   assert((eStatus == CHUNK_FREE) || (eStatus == CHUNK_INUSE));
+
+   oChunk->uOrder &= ~1UL;
+   oChunk->uOrder |= eStatus;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Chunk_getOrder(Chunk_T oChunk)
+{
+   assert(oChunk != NULL);
+
+   return (int)(oChunk->uOrder >> 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+void Chunk_setOrder(Chunk_T oChunk, int iOrder)
+{
+   assert(oChunk != NULL);
+   assert(iOrder >= MIN_ORDER);
+
+   oChunk->uOrder &= 1UL;
+   oChunk->uOrder |= (size_t)iOrder << 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+Chunk_T Chunk_getNextInList(Chunk_T oChunk)
+{
+   assert(oChunk != NULL);
+
+   return oChunk->oAdjacentChunk;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Chunk_setNextInList(Chunk_T oChunk, Chunk_T oNextChunk)
+{
+   assert(oChunk != NULL);
+
+   oChunk->oAdjacentChunk = oNextChunk;
+}
+
+/*--------------------------------------------------------------------*/
+
+Chunk_T Chunk_getPrevInList(Chunk_T oChunk)
+{
+   assert(oChunk != NULL);
+
+   return (oChunk + 1)->oAdjacentChunk;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Chunk_setPrevInList(Chunk_T oChunk, Chunk_T oPrevChunk)
+{
+   assert(oChunk != NULL);
+
+   (oChunk + 1)->oAdjacentChunk = oPrevChunk;
+}
+
+/*--------------------------------------------------------------------*/
+
+Chunk_T Chunk_getBuddy(Chunk_T oChunk, Chunk_T oHeapStart)
+{
+   size_t uOffset;
+
+   assert(oChunk != NULL);
+   assert(oHeapStart != NULL);
+   assert(oChunk >= oHeapStart);
+
+   /* The buddy's offset differs from oChunk's in exactly the bit
+      that is worth the Chunk's size. */
+   uOffset = (size_t)((char*)oChunk - (char*)oHeapStart);
+   uOffset ^= Chunk_orderToBytes(Chunk_getOrder(oChunk));
+   return (Chunk_T)((char*)oHeapStart + uOffset);
+}
+
+/*--------------------------------------------------------------------*/
+
+Chunk_T Chunk_getNextInMem(Chunk_T oChunk, Chunk_T oHeapEnd)
+{
+   Chunk_T oNextChunk;
+
+   assert(oChunk != NULL);
+   assert(oHeapEnd != NULL);
+   assert(oChunk < oHeapEnd);
+
+   oNextChunk = (Chunk_T)((char*)oChunk
+      + Chunk_orderToBytes(Chunk_getOrder(oChunk)));
+   assert(oNextChunk <= oHeapEnd);
+
+   if (oNextChunk == oHeapEnd)
+      return NULL;
+   return oNextChunk;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Chunk_isValid(Chunk_T oChunk,
+                  Chunk_T oHeapStart, Chunk_T oHeapEnd)
+{
+   size_t uOffset;
+   size_t uHeapBytes;
+   int iOrder;
+
+   assert(oChunk != NULL);
+   assert(oHeapStart != NULL);
+   assert(oHeapEnd != NULL);
+
+   if (oChunk < oHeapStart)
+   {  fprintf(stderr, "A chunk starts before the heap start\n");
+      return 0;
+   }
+   if (oChunk >= oHeapEnd)
+   {  fprintf(stderr, "A chunk starts after the heap end\n");
+      return 0;
+   }
+
+   iOrder = Chunk_getOrder(oChunk);
+   uOffset = (size_t)((char*)oChunk - (char*)oHeapStart);
+   uHeapBytes = (size_t)((char*)oHeapEnd - (char*)oHeapStart);
+   if ((iOrder < MIN_ORDER)
+      || (iOrder >= (int)(sizeof(size_t) * CHAR_BIT)))
+   {  fprintf(stderr, "A chunk has a bad order\n");
+      return 0;
+   }
+   if (Chunk_orderToBytes(iOrder) > uHeapBytes - uOffset)
+   {  fprintf(stderr, "A chunk ends after the heap end\n");
+      return 0;
+   }
+   if ((uOffset & (Chunk_orderToBytes(iOrder) - 1)) != 0)
+   {  fprintf(stderr, "A chunk is misaligned for its order\n");
+      return 0;
+   }
+   return 1;
+}
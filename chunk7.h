@@ -0,0 +1,133 @@
+/*--------------------------------------------------------------------*/
+/* chunk7.h                                                           */
+/* Author: Isaac Wolfe and Isaac Hart                                 */
+/*--------------------------------------------------------------------*/
+
+#ifndef CHUNK7_INCLUDED
+#define CHUNK7_INCLUDED
+
+#include <stddef.h>
+
+/* A Chunk can be either free or in use. */
+enum ChunkStatus {CHUNK_FREE, CHUNK_INUSE};
+
+/* A Chunk is a block of a binary buddy system: a sequence of 2^order
+   bytes that starts at a multiple of 2^order bytes from the start of
+   the heap. The first unit is a header that indicates the Chunk's
+   order, whether the Chunk is free, and, if the Chunk is free, a
+   pointer to the next Chunk in its free list. If the Chunk is free,
+   the second unit holds a pointer to the previous Chunk in its free
+   list. There is no footer: the Chunk's buddy, the other half of the
+   block of the next higher order, is found from its address alone. */
+
+typedef struct Chunk *Chunk_T;
+
+/*--------------------------------------------------------------------*/
+
+/* The smallest order of a Chunk: room for a header and a previous
+   pointer, and thus for a payload of at least one unit. */
+
+enum {MIN_ORDER = 5};
+
+/*--------------------------------------------------------------------*/
+
+/* Return the order of the smallest Chunk whose payload can hold
+   uBytes bytes, or 0 if there is no such Chunk. */
+
+int Chunk_bytesToOrder(size_t uBytes);
+
+/*--------------------------------------------------------------------*/
+
+/* Translate iOrder, an order, to bytes. Return the result. */
+
+size_t Chunk_orderToBytes(int iOrder);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the address of the payload of oChunk. */
+
+void *Chunk_toPayload(Chunk_T oChunk);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the Chunk whose payload is pointed to by pv. */
+
+Chunk_T Chunk_fromPayload(void *pv);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the status of oChunk. */
+
+enum ChunkStatus Chunk_getStatus(Chunk_T oChunk);
+
+/*--------------------------------------------------------------------*/
+
+/* Set the status of oChunk to eStatus. */
+
+void Chunk_setStatus(Chunk_T oChunk, enum ChunkStatus eStatus);
+
+/*--------------------------------------------------------------------*/
+
+/* Return oChunk's order. */
+
+int Chunk_getOrder(Chunk_T oChunk);
+
+/*--------------------------------------------------------------------*/
+
+/* Set oChunk's order to iOrder. */
+
+void Chunk_setOrder(Chunk_T oChunk, int iOrder);
+
+/*--------------------------------------------------------------------*/
+
+/* Return oChunk's next Chunk in the free list, or NULL if there
+   is no next Chunk. */
+
+Chunk_T Chunk_getNextInList(Chunk_T oChunk);
+
+/*--------------------------------------------------------------------*/
+
+/* Set oChunk's next Chunk in the free list to oNextChunk. */
+
+void Chunk_setNextInList(Chunk_T oChunk, Chunk_T oNextChunk);
+
+/*--------------------------------------------------------------------*/
+
+/* Return oChunk's previous Chunk in the free list, or NULL if there
+   is no previous Chunk. */
+
+Chunk_T Chunk_getPrevInList(Chunk_T oChunk);
+
+/*--------------------------------------------------------------------*/
+
+/* Set oChunk's previous Chunk in the free list to oPrevChunk. */
+
+void Chunk_setPrevInList(Chunk_T oChunk, Chunk_T oPrevChunk);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the address of oChunk's buddy: the Chunk of the same order
+   that, with oChunk, forms a block of the next higher order. Use
+   oHeapStart as the origin of the buddy system. oChunk's order must
+   be set properly for this function to work. */
+
+Chunk_T Chunk_getBuddy(Chunk_T oChunk, Chunk_T oHeapStart);
+
+/*--------------------------------------------------------------------*/
+
+/* Return oChunk's next Chunk in memory, or NULL if there is no
+   next Chunk. Use oHeapEnd to determine if there is no next
+   Chunk. oChunk's order must be set properly for this function to
+   work. */
+
+Chunk_T Chunk_getNextInMem(Chunk_T oChunk, Chunk_T oHeapEnd);
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) if oChunk is valid, notably with respect to
+   oHeapStart and oHeapEnd, or 0 (FALSE) otherwise. */
+
+int Chunk_isValid(Chunk_T oChunk,
+                  Chunk_T oHeapStart, Chunk_T oHeapEnd);
+
+#endif
@@ -25,4 +25,115 @@ void *HeapMgr_malloc(size_t uBytes);
 
 void HeapMgr_free(void *pv);
 
+/*--------------------------------------------------------------------*/
+
+/* The declarations below form an extended interface that only some
+   heap managers implement. A client that uses it must be linked with
+   such a heap manager; testheapmgr.c uses it only if HEAPMGR_EXTENDED
+   is defined. */
+
+/* Statistics about a heap manager's use of memory. */
+
+struct HeapMgrStats
+{
+   /* The number of bytes obtained from the OS other than by moving
+      the program break. */
+   size_t uMappedBytes;
+
+   /* The number of chunks freed, and the number of insertions into
+      and removals from bins that the heap manager has made. */
+   size_t uChunkFrees;
+   size_t uBinOps;
+
+   /* The number of bytes of free memory whose pages the heap manager
+      has returned to the OS while keeping their addresses. */
+   size_t uPurgedBytes;
+
+   /* The number of blocks that the heap manager has resized, the
+      number of those that it had to copy, and the number of copies
+      that it avoided by remapping the pages of mapped blocks. */
+   size_t uReallocs;
+   size_t uReallocCopies;
+   size_t uReallocRemaps;
+
+   /* The number of bytes that the heap manager has allocated zeroed,
+      the number of those that it had to zero rather than knowing them
+      to be zero already, and the number that a helper thread had
+      zeroed in advance. */
+   size_t uCallocBytes;
+   size_t uCallocZeroedBytes;
+   size_t uCallocPrezeroedBytes;
+
+   /* The number of calls to the OS that the heap manager has made to
+      grow and shrink its heap, and the number of bytes that it has
+      requested by them in all. */
+   size_t uOsCalls;
+   size_t uRequestedBytes;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Store the heap manager's statistics in *psStats. */
+
+void HeapMgr_getStats(struct HeapMgrStats *psStats);
+
+/*--------------------------------------------------------------------*/
+
+/* Coalesce the chunks whose coalescing the heap manager has deferred,
+   so that their memory can serve requests of any size. */
+
+void HeapMgr_consolidate(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Return free memory at the end of the heap to the OS, keeping uKeep
+   bytes of it for future requests. Return 1 (TRUE) if any memory was
+   returned, or 0 (FALSE) otherwise. */
+
+int HeapMgr_trim(size_t uKeep);
+
+/*--------------------------------------------------------------------*/
+
+/* Grow the heap in one step, if need be, so that it holds uBytes bytes
+   of free memory at its end, and keep HeapMgr_free from returning that
+   memory to the OS until the next call. If bPrefault is 1 (TRUE), also
+   have the OS back that memory with pages now, so that using it later
+   takes no page faults. Return 1 (TRUE) if successful, or 0 (FALSE) if
+   the OS refused. */
+
+int HeapMgr_reserve(size_t uBytes, int bPrefault);
+
+/*--------------------------------------------------------------------*/
+
+/* Resize the block of memory pointed to by pv, which must have been
+   allocated by HeapMgr_malloc() or HeapMgr_realloc(), to hold uBytes
+   bytes, keeping its contents up to the lesser of its old and new
+   sizes. Resize it in place if possible, and otherwise move it. If pv
+   is NULL, act as HeapMgr_malloc(uBytes); if uBytes is 0, act as
+   HeapMgr_free(pv) and return NULL. Return the address of the
+   resized block, or NULL, leaving the block unchanged, if the request
+   cannot be satisfied. */
+
+void *HeapMgr_realloc(void *pv, size_t uBytes);
+
+/*--------------------------------------------------------------------*/
+
+/* Allocate and return the address of a chunk of memory that is large
+   enough to hold an array of uCount objects whose size is uSize bytes,
+   as HeapMgr_malloc() does, with every byte set to zero. Return NULL
+   if the array's size is 0 or cannot be represented, or if the
+   request cannot be satisfied. */
+
+void *HeapMgr_calloc(size_t uCount, size_t uSize);
+
+/*--------------------------------------------------------------------*/
+
+/* Allocate and return the address of a chunk of memory that is large
+   enough to hold an object whose size is uBytes bytes, as
+   HeapMgr_malloc() does, at an address that is a multiple of
+   uAlignment. Return NULL if uAlignment is not a power of 2, if uBytes
+   is 0, or if the request cannot be satisfied. */
+
+void *HeapMgr_memalign(size_t uAlignment, size_t uBytes);
+
 #endif
@@ -8,39 +8,258 @@
 #include "heapmgr.h"
 #include "checker5.h"
 #include "chunk5.h"
+#include "bin5.h"
+#include "slab5.h"
+#include "large5.h"
+#include "pagemap5.h"
+#include "segment5.h"
+#ifdef HEAPMGR_PREZERO
+#include "zeropool5.h"
+#endif
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
 #include <assert.h>
-#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* In lieu of a boolean data type. */
+enum {FALSE, TRUE};
 
 /*--------------------------------------------------------------------*/
 
-/* Size of the bin array and maximum. */
-enum {BIN_MAX = 1024};
+/* The number of bins tracked by one word of the bin map, and the
+   number of words in the bin map. The summary word has one bit per
+   bin map word, so BIN_MAP_WORDS must not exceed BITS_PER_WORD. */
+enum {BITS_PER_WORD = (int)(sizeof(unsigned long) * CHAR_BIT)};
+enum {BIN_MAP_WORDS = (BIN_COUNT + BITS_PER_WORD - 1) / BITS_PER_WORD};
+
+/* The number of units of the largest chunk kept in a fast bin. It can
+   be changed by defining FAST_MAX_UNITS when compiling; 0 disables the
+   fast bins. */
+#ifndef FAST_MAX_UNITS
+#define FAST_MAX_UNITS 64
+#endif
+
+/* The number of units of the smallest chunk whose release makes
+   HeapMgr_free consolidate the fast bins. */
+enum {FAST_CONSOLIDATE_UNITS = 4096};
+
+/* HeapMgr_getMoreMemory asks the OS for at least 1/2^GROW_SHIFT of the
+   memory committed to the heap, but for no more than GROW_MAX_BYTES on
+   that account, so that a growing heap calls the OS a number of times
+   logarithmic in its size until the cap is reached, at the cost of
+   holding at most that fraction unused. They can be changed by
+   defining GROW_SHIFT and GROW_MAX_BYTES when compiling. */
+#ifndef GROW_SHIFT
+#define GROW_SHIFT 3
+#endif
+#ifndef GROW_MAX_BYTES
+#define GROW_MAX_BYTES ((size_t)16 * 1024 * 1024)
+#endif
+
+/* The size of the top chunk above which HeapMgr_free returns memory at
+   the end of the heap to the OS, and the size to which it shrinks the
+   top chunk. As in glibc, the threshold is also at least twice the
+   threshold above which chunks are mapped, and the top chunk keeps at
+   least as much as the heap would next grow by, so that trimming does
+   not undo growth. They can be changed by defining
+   TRIM_THRESHOLD_BYTES and TRIM_KEEP_BYTES when compiling. */
+#ifndef TRIM_THRESHOLD_BYTES
+#define TRIM_THRESHOLD_BYTES ((size_t)256 * 1024)
+#endif
+#ifndef TRIM_KEEP_BYTES
+#define TRIM_KEEP_BYTES ((size_t)64 * 1024)
+#endif
+
+/* The number of milliseconds for which a free chunk's pages can stay
+   unused before HeapMgr_free purges them, and the number of frees
+   between readings of the clock. As in jemalloc, purging is lazy: a
+   chunk is purged on the first reading at least half that time after
+   the last purge. They can be changed by defining PURGE_DECAY_MS and
+   PURGE_CHECK_FREES when compiling. */
+#ifndef PURGE_DECAY_MS
+#define PURGE_DECAY_MS ((size_t)10000)
+#endif
+#ifndef PURGE_CHECK_FREES
+#define PURGE_CHECK_FREES 256
+#endif
+
+/* How a free chunk's pages are purged. MADV_DONTNEED returns them at
+   once, and they read as zeros afterwards. Defining PURGE_LAZY when
+   compiling uses MADV_FREE instead, which lets the OS take them only
+   when it is short of memory. */
+#if defined(PURGE_LAZY) && defined(MADV_FREE)
+#define PURGE_ADVICE MADV_FREE
+#else
+#define PURGE_ADVICE MADV_DONTNEED
+#endif
+
+/* The number of bytes from which HeapMgr_calloc zeroes memory that may
+   have been used with non-temporal stores, which bypass the cache, so
+   that zeroing a large block neither waits to read it into the cache
+   nor evicts everything else. It applies where SSE2 is available, and
+   can be changed by defining ZERO_STREAM_BYTES when compiling. */
+#ifndef ZERO_STREAM_BYTES
+#define ZERO_STREAM_BYTES ((size_t)1024 * 1024)
+#endif
 
 /*--------------------------------------------------------------------*/
 
 /* The state of the HeapMgr. */
 
-/* The address of the start of the heap. */
-static Chunk_T oHeapStart = NULL;
-
-/* The address immediately beyond the end of the heap. */
-static Chunk_T oHeapEnd = NULL;
-
-/* Integer array to contain the bins */
-static Chunk_T bins[BIN_MAX];
+/* Integer array to contain the bins, laid out as described in bin5.h.
+   An exact bin is a free list. Every other bin holds a range of sizes,
+   and is the root of a treap ordered by (units, address). */
+static Chunk_T bins[BIN_COUNT];
+
+/* The bin map: bit i of aulBinMap[w] is set iff bin
+   w * BITS_PER_WORD + i is non-empty. Bit w of ulBinMapSummary is set
+   iff aulBinMap[w] is non-zero. */
+static unsigned long aulBinMap[BIN_MAP_WORDS];
+static unsigned long ulBinMapSummary = 0;
+
+/* The top chunk: the last chunk of the newest segment, the one that
+   grows, if it is free, or NULL if it is in use. The top chunk is in
+   no bin. Requests that no bin can serve are carved from its front,
+   and growing the segment extends it in place. */
+static Chunk_T oTop = NULL;
+
+/* The fast bins. Fast bin i is a LIFO list, linked through the
+   headers, of freed chunks of i units that have not been coalesced.
+   Their status is still CHUNK_INUSE, so that no neighbour coalesces
+   with them until the fast bins are consolidated. */
+static Chunk_T aoFastBins[FAST_MAX_UNITS + 1];
+
+/* The number of chunks in the fast bins. */
+static size_t uFastCount = 0;
+
+/* The number of chunks freed, and the number of insertions into and
+   removals from bins. */
+static size_t uChunkFrees = 0;
+static size_t uBinOps = 0;
+
+/* The time, in milliseconds, of the last reading of the clock and of
+   the last purge, and the number of bytes purged. Chunks freed between
+   readings record the time of the last one. */
+static size_t uPurgeNow = 0;
+static size_t uLastPurge = 0;
+static size_t uPurgedBytes = 0;
+
+/* The number of calls of HeapMgr_realloc that resized a block, the
+   number of those that had to copy it, and the number that moved a
+   mapped chunk by remapping its pages rather than by copying them. */
+static size_t uReallocs = 0;
+static size_t uReallocCopies = 0;
+static size_t uReallocRemaps = 0;
+
+/* The number of bytes that HeapMgr_calloc has allocated, the number
+   of those that it had to zero, and the number that the zero pool had
+   zeroed in advance. */
+static size_t uCallocBytes = 0;
+static size_t uCallocZeroedBytes = 0;
+static size_t uCallocPrezeroedBytes = 0;
+
+#ifdef HEAPMGR_PREZERO
+/* The number of chunks offered to the zero pool since HeapMgr_calloc
+   last consulted it. */
+static size_t uPrezeroIdleFrees = 0;
+#endif
+
+/* The number of bytes reserved by HeapMgr_reserve. HeapMgr_free
+   neither trims the top chunk below that size nor purges it while
+   there is a reservation. */
+static size_t uReservedBytes = 0;
 
 /*--------------------------------------------------------------------*/
 
 /* Static function definitions */
 
-/* Get more memory of uUnits. Coalesce as necessary. Returns the 
-   increased memory chunk. */
+/* Return the number of bytes by which the heap grows at least. */
+static size_t HeapMgr_getGrowBytes(void);
+
+/* Get more memory, so that the top chunk has at least uUnits units.
+   Return the top chunk, or NULL if the OS refused. */
 static Chunk_T HeapMgr_getMoreMemory(size_t uUnits);
 
+/* Carve a chunk of uUnits units from the front of the top chunk, which
+   must be large enough. Return the chunk in use. */
+static Chunk_T HeapMgr_useTop(size_t uUnits);
+
+/* Shrink the top chunk to uKeepBytes bytes, or to none, decommitting
+   the pages released. Return TRUE if the heap shrank, and FALSE
+   otherwise. */
+static int HeapMgr_trimTop(size_t uKeepBytes);
+
+/* Return the time recorded in oChunk, which is free, or the current
+   time if it is too small to be purged. */
+static size_t HeapMgr_getFreeTime(Chunk_T oChunk);
+
+/* Record uTime in oChunk, which is free, if it is large enough to be
+   purged. */
+static void HeapMgr_setFreeTime(Chunk_T oChunk, size_t uTime);
+
+/* Purge the pages inside oChunk, which is free, if it has been free
+   for long enough and is not purged already. */
+static void HeapMgr_purgeChunk(Chunk_T oChunk);
+
+/* Purge the pages of the chunks in the treap rooted at oRoot. */
+static void HeapMgr_purgeTree(Chunk_T oRoot);
+
+/* Read the clock, and purge the pages of the chunks that have been
+   free for too long if it is time to. */
+static void HeapMgr_decay(void);
+
+/* Return the chunk after oChunk in memory. */
+static Chunk_T HeapMgr_getNextInMem(Chunk_T oChunk);
+
+/* Set the status of oChunk to eStatus, and record it as the previous
+   status of the next chunk in memory. */
+static void HeapMgr_setStatus(Chunk_T oChunk, enum ChunkStatus eStatus);
+
+/* Insert oChunk at the front of its bin. */
+static void HeapMgr_insert(Chunk_T oChunk);
+
 /* Remove oChunk from the free list. */
 static void HeapMgr_remove(Chunk_T oChunk);
 
+/* Free oChunk, which is in use, coalescing it with its neighbours in
+   memory and inserting the result into its bin, unless it becomes the
+   top chunk. */
+static void HeapMgr_release(Chunk_T oChunk);
+
+/* Return the index of the first non-empty bin at or after iBin, or
+   -1 if there is no such bin. */
+static int HeapMgr_findNextBin(int iBin);
+
+/* Return the treap priority of oChunk. */
+static size_t HeapMgr_treePriority(Chunk_T oChunk);
+
+/* Return 1 (TRUE) if oChunk orders before oOtherChunk in the treap,
+   or 0 (FALSE) otherwise. */
+static int HeapMgr_treeIsBefore(Chunk_T oChunk, Chunk_T oOtherChunk);
+
+/* Insert oChunk into the treap rooted at oRoot. Return the new
+   root. */
+static Chunk_T HeapMgr_treeInsert(Chunk_T oRoot, Chunk_T oChunk);
+
+/* Merge the treaps rooted at oLeft and oRight. Return the new
+   root. */
+static Chunk_T HeapMgr_treeMerge(Chunk_T oLeft, Chunk_T oRight);
+
+/* Remove oChunk from the treap rooted at oRoot. Return the new
+   root. */
+static Chunk_T HeapMgr_treeRemove(Chunk_T oRoot, Chunk_T oChunk);
+
+/* Return the smallest chunk of at least uUnits units in the treap
+   rooted at oRoot, or NULL if there is no such chunk. */
+static Chunk_T HeapMgr_treeFindBestFit(Chunk_T oRoot, size_t uUnits);
+
 /* Use oChunk to store uUnits. Split it if is it sufficiently large
    and coalesce as necessary. Returns the chunk in use. */
 static Chunk_T HeapMgr_useChunk(Chunk_T oChunk, size_t uUnits);
@@ -49,91 +268,434 @@ static Chunk_T HeapMgr_useChunk(Chunk_T oChunk, size_t uUnits);
    chunk of memory that works for uUnits. */
 static Chunk_T HeapMgr_findUsableChunk(size_t uUnits);
 
+/* Return the number of bytes that the payload of oChunk can hold. */
+static size_t HeapMgr_getPayloadBytes(Chunk_T oChunk);
+
+/* Shrink oChunk, which is in use, to uUnits units, releasing the
+   rest. */
+static void HeapMgr_shrinkChunk(Chunk_T oChunk, size_t uUnits);
+
+/* Grow oChunk, which is in use, to at least uUnits units in place.
+   Return TRUE if successful, and FALSE otherwise. */
+static int HeapMgr_growChunk(Chunk_T oChunk, size_t uUnits);
+
+/* Set the uBytes bytes at pv to zero, bypassing the cache if there are
+   many. */
+static void HeapMgr_zero(void *pv, size_t uBytes);
+
+/* Return a chunk of at least uUnits units from the heap, in use, or
+   NULL if the OS refused. */
+static Chunk_T HeapMgr_allocChunk(size_t uUnits);
+
+#ifdef HEAPMGR_PREZERO
+/* Free every chunk that the zero pool has given back. */
+static void HeapMgr_drainZeroPool(void);
+#endif
+
+/*--------------------------------------------------------------------*/
+
+#ifndef NDEBUG
+/* Return 1 (TRUE) if the heap is in a valid state, or 0 (FALSE)
+   otherwise. */
+
+static int HeapMgr_isValid(void)
+{
+   return Segment_isValid() && Checker_isValid(bins, BIN_COUNT,
+      aulBinMap, ulBinMapSummary, oTop, aoFastBins, FAST_MAX_UNITS + 1)
+      && Slab_isValid() && Large_isValid()
+#ifdef HEAPMGR_PREZERO
+      && ZeroPool_isValid()
+#endif
+      ;
+}
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes by which the heap grows at least:
+   1/2^GROW_SHIFT of the memory committed to it, but no more than
+   GROW_MAX_BYTES. */
+
+static size_t HeapMgr_getGrowBytes(void)
+{
+   size_t uBytes = Segment_getMappedBytes() >> GROW_SHIFT;
+
+   if (uBytes > GROW_MAX_BYTES)
+      uBytes = GROW_MAX_BYTES;
+   return uBytes;
+}
+
 /*--------------------------------------------------------------------*/
 
-/* Request more memory from the operating system -- enough to store
-   uUnits units. Create a new chunk, and appends it to the
-   front of its corresponding bin, coalescing with oPrevChunk if
-   necessary. Return the address of the new (or enlarged) chunk. */
+/* Grow the newest segment, so that the top chunk has at least uUnits
+   units. Extend the top chunk in place if there is one, or else make
+   the new memory the top chunk. If the newest segment cannot grow
+   enough, start a new segment, and put the old top chunk in its bin.
+   Return the top chunk, or NULL if the OS refused. */
 
 static Chunk_T HeapMgr_getMoreMemory(size_t uUnits)
 {
-   const size_t MIN_UNITS_FROM_OS = 512;
-   Chunk_T oChunk;
-   Chunk_T oNewHeapEnd;
-   Chunk_T oPrevChunkInMemory;
-   size_t uBytes;
+   size_t uMinUnits = 512;
+   Segment_T oSegment;
+   Chunk_T oChunk = NULL;
+   size_t uTopUnits = 0;
    size_t uNewUnits;
-   int iBinSize;
-   int iPrevChunkSize;
+   size_t uTime;
+   int bZero;
+
+   /* Ask for at least a Segment page, which in huge page mode is a
+      huge page, and for more as the heap grows. */
+   if (uMinUnits < SEGMENT_PAGE_BYTES / Chunk_unitsToBytes(1))
+      uMinUnits = SEGMENT_PAGE_BYTES / Chunk_unitsToBytes(1);
+   if (uMinUnits < HeapMgr_getGrowBytes() / Chunk_unitsToBytes(1))
+      uMinUnits = HeapMgr_getGrowBytes() / Chunk_unitsToBytes(1);
+
+   /* Only the units that the top chunk lacks are needed, unless the
+      top chunk cannot grow that large. */
+   if (oTop != NULL)
+      uTopUnits = Chunk_getUnits(oTop);
+   assert(uTopUnits < uUnits);
+   uNewUnits = uUnits - uTopUnits;
+   if (uNewUnits < uMinUnits)
+      uNewUnits = uMinUnits;
+   if (uTopUnits + uNewUnits > MAX_UNITS_PER_CHUNK)
+   {
+      uNewUnits = uUnits;
+      if (uNewUnits < uMinUnits)
+         uNewUnits = uMinUnits;
+   }
 
-   if (uUnits < MIN_UNITS_FROM_OS)
-      uUnits = MIN_UNITS_FROM_OS;
+   /* Grow the newest segment. */
+   oSegment = Segment_getFirst();
+   if (oSegment != NULL)
+      oChunk = Segment_grow(oSegment, uNewUnits);
+
+   /* Extend the top chunk in place if it can grow that large. The new
+      pages are untouched, so a purged top chunk stays purged. A top
+      chunk that is zero stays zero if the new memory is too, once the
+      old footer and the old end chunk's header, now inside it, are
+      cleared. */
+   if ((oChunk != NULL) && (oTop != NULL)
+      && (uTopUnits + uNewUnits <= MAX_UNITS_PER_CHUNK))
+   {
+      uTime = HeapMgr_getFreeTime(oTop);
+      bZero = Chunk_isZero(oTop) && Chunk_isZero(oChunk);
+      if (bZero)
+         memset((char*)oChunk - Chunk_unitsToBytes(1), 0,
+            Chunk_unitsToBytes(2));
+      Chunk_setUnits(oTop, uTopUnits + uNewUnits);
+      HeapMgr_setStatus(oTop, CHUNK_FREE);
+      HeapMgr_setFreeTime(oTop, uTime);
+      Chunk_setZero(oTop, bZero);
+      return oTop;
+   }
 
-   /* Move the program break. */
-   uBytes = Chunk_unitsToBytes(uUnits);
-   oNewHeapEnd = (Chunk_T)((char*)oHeapEnd + uBytes);
-   if (oNewHeapEnd < oHeapEnd)  /* Check for overflow */
-      return NULL;
-   if (brk(oNewHeapEnd) == -1)
-      return NULL;
-   oChunk = oHeapEnd;
-   oHeapEnd = oNewHeapEnd;
+   /* If the newest segment cannot grow, start a new one that holds the
+      whole request. */
+   if (oChunk == NULL)
+   {
+      if (uNewUnits < uUnits)
+         uNewUnits = uUnits;
+      oSegment = Segment_new(uNewUnits);
+      if (oSegment == NULL)
+         return NULL;
+      oChunk = Segment_grow(oSegment, uNewUnits);
+      if (oChunk == NULL)
+      {
+         Segment_free(oSegment);
+         return NULL;
+      }
+   }
+
+   /* A top chunk that can grow no more goes into its bin, and the new
+      memory becomes the top chunk, zero if Segment_grow found it
+      fresh. */
+   if (oTop != NULL)
+      HeapMgr_insert(oTop);
+   Chunk_setPurged(oChunk, FALSE);
+   HeapMgr_setStatus(oChunk, CHUNK_FREE);
+   HeapMgr_setFreeTime(oChunk, uPurgeNow);
+   oTop = oChunk;
+   return oTop;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Carve a chunk of uUnits units from the front of the top chunk, which
+   must have at least that many. If the rest would be too small to be
+   a chunk, use the whole top chunk, leaving none. Return the chunk in
+   use. */
+
+static Chunk_T HeapMgr_useTop(size_t uUnits)
+{
+   Chunk_T oChunk = oTop;
+   size_t uTopUnits;
+   size_t uTime;
+   int bPurged;
+   int bZero;
+
+   assert(oTop != NULL);
 
-   /* Set the fields of the new chunk. */
+   uTopUnits = Chunk_getUnits(oTop);
+   assert(uTopUnits >= uUnits);
+
+   bPurged = Chunk_isPurged(oChunk);
+   bZero = Chunk_isZero(oChunk);
+   Chunk_setPurged(oChunk, FALSE);
+   if (uTopUnits < uUnits + MIN_UNITS_PER_CHUNK)
+   {
+      HeapMgr_setStatus(oChunk, CHUNK_INUSE);
+      oTop = NULL;
+      return oChunk;
+   }
+
+   /* Mark the front in use before shrinking it, so that it gets no
+      footer, and make the rest the top chunk. The rest's pages are
+      still purged if the top chunk's were, and the front and the rest
+      are both still zero if the top chunk was. */
+   uTime = HeapMgr_getFreeTime(oChunk);
+   Chunk_setStatus(oChunk, CHUNK_INUSE);
    Chunk_setUnits(oChunk, uUnits);
-/*   Chunk_setNextInList(oChunk, NULL);
-   Chunk_setPrevInList(oChunk, NULL); */
-   Chunk_setStatus(oChunk, CHUNK_FREE);
+   oTop = HeapMgr_getNextInMem(oChunk);
+   Chunk_setUnits(oTop, uTopUnits - uUnits);
+   Chunk_setStatus(oTop, CHUNK_FREE);
+   Chunk_setPrevStatus(oTop, CHUNK_INUSE);
+   Chunk_setMapped(oTop, FALSE);
+   Chunk_setPurged(oTop, bPurged);
+   Chunk_setZero(oTop, bZero);
+   HeapMgr_setFreeTime(oTop, uTime);
+   return oChunk;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Shrink the top chunk to uKeepBytes bytes, rounded up to a chunk and
+   to the end of a Segment page, or remove it if uKeepBytes is 0, by
+   shrinking the newest segment, which returns the pages released to
+   the OS. Do nothing unless at least a Segment page would be
+   released. Return TRUE if the heap shrank, and FALSE
+   otherwise. */
+
+static int HeapMgr_trimTop(size_t uKeepBytes)
+{
+   Chunk_T oNewEnd;
+   char *pcLimit;
+   size_t uTopUnits;
+   size_t uKeepUnits;
+
+   if (oTop == NULL)
+      return FALSE;
+
+   uTopUnits = Chunk_getUnits(oTop);
+   uKeepUnits = (uKeepBytes + Chunk_unitsToBytes(1) - 1)
+      / Chunk_unitsToBytes(1);
+   if ((uKeepUnits != 0) && (uKeepUnits < MIN_UNITS_PER_CHUNK))
+      uKeepUnits = MIN_UNITS_PER_CHUNK;
+
+   /* Keep the rest of the Segment page in which the new end chunk
+      ends, since it stays committed; in huge page mode, that leaves
+      the huge page whole. */
+   if (uKeepUnits != 0)
+   {
+      pcLimit = (char*)oTop
+         + Chunk_unitsToBytes(uKeepUnits + MIN_UNITS_PER_CHUNK);
+      uKeepUnits += ((SEGMENT_PAGE_BYTES
+         - (size_t)pcLimit % SEGMENT_PAGE_BYTES) % SEGMENT_PAGE_BYTES)
+         / Chunk_unitsToBytes(1);
+   }
+   if ((uTopUnits <= uKeepUnits)
+      || (Chunk_unitsToBytes(uTopUnits - uKeepUnits)
+         < SEGMENT_PAGE_BYTES))
+      return FALSE;
+
+   /* Move the end of the newest segment, which holds the top chunk,
+      back. With the top chunk gone, the chunk before the end is in
+      use. */
+   oNewEnd = (Chunk_T)((char*)oTop + Chunk_unitsToBytes(uKeepUnits));
+   if (uKeepUnits == 0)
+   {
+      if (! Segment_shrink(Segment_getFirst(), oNewEnd, CHUNK_INUSE))
+         return FALSE;
+      oTop = NULL;
+      return TRUE;
+   }
+   if (! Segment_shrink(Segment_getFirst(), oNewEnd, CHUNK_FREE))
+      return FALSE;
+   Chunk_setUnits(oTop, uKeepUnits);
+   return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the time recorded in oChunk, which is free, or the time of
+   the last reading of the clock if oChunk is too small to be purged
+   and so records none. */
+
+static size_t HeapMgr_getFreeTime(Chunk_T oChunk)
+{
+   assert(Chunk_getStatus(oChunk) == CHUNK_FREE);
+
+   if (Chunk_unitsToBytes(Chunk_getUnits(oChunk)) < 2 * PAGE_BYTES)
+      return uPurgeNow;
+   return Chunk_getFreeTime(oChunk);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Record uTime in oChunk, which is free, as the time at which its
+   pages were last used, if oChunk is large enough to hold a whole page
+   between its header and footer and so to be purged. */
+
+static void HeapMgr_setFreeTime(Chunk_T oChunk, size_t uTime)
+{
+   assert(Chunk_getStatus(oChunk) == CHUNK_FREE);
+
+   if (Chunk_unitsToBytes(Chunk_getUnits(oChunk)) >= 2 * PAGE_BYTES)
+      Chunk_setFreeTime(oChunk, uTime);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* If oChunk, which is free, is large enough to be purged, is not
+   purged already and has been free for at least PURGE_DECAY_MS, return
+   the whole Segment pages between the Unit that records its time and
+   its footer to the OS, keeping their addresses, and mark it purged.
+   In huge page mode, only whole huge pages are purged, so that none is
+   split. */
+
+static void HeapMgr_purgeChunk(Chunk_T oChunk)
+{
+   size_t uUnits = Chunk_getUnits(oChunk);
+   char *pcFirstPage;
+   char *pcEndPage;
+
+   assert(Chunk_getStatus(oChunk) == CHUNK_FREE);
+
+   if (Chunk_isPurged(oChunk)
+      || (Chunk_unitsToBytes(uUnits) < 2 * SEGMENT_PAGE_BYTES)
+      || (uPurgeNow < Chunk_getFreeTime(oChunk) + PURGE_DECAY_MS))
+      return;
 
-   /* Insert at front of proper bin.
-      Check if current bin size is larger than maximum. */
-   iBinSize = (int)Chunk_getUnits(oChunk);
-   if (iBinSize > BIN_MAX - 1) iBinSize = BIN_MAX - 1;
+   pcFirstPage = (char*)oChunk + Chunk_unitsToBytes(2)
+      + SEGMENT_PAGE_BYTES - 1;
+   pcFirstPage -= (size_t)pcFirstPage % SEGMENT_PAGE_BYTES;
+   pcEndPage = (char*)oChunk + Chunk_unitsToBytes(uUnits - 1);
+   pcEndPage -= (size_t)pcEndPage % SEGMENT_PAGE_BYTES;
+   if ((pcFirstPage < pcEndPage)
+      && (madvise(pcFirstPage, (size_t)(pcEndPage - pcFirstPage),
+         PURGE_ADVICE) == 0))
+   {
+      uPurgedBytes += (size_t)(pcEndPage - pcFirstPage);
+      Chunk_setPurged(oChunk, TRUE);
+   }
+}
 
-   /* Set pointers. */
-   if (bins[iBinSize] != NULL) 
-      Chunk_setPrevInList(bins[iBinSize], oChunk);
-   Chunk_setNextInList(oChunk, bins[iBinSize]);
-   bins[iBinSize] = oChunk;
-   Chunk_setPrevInList(bins[iBinSize], NULL);
+/*--------------------------------------------------------------------*/
 
+/* Purge the pages of every chunk in the treap rooted at oRoot that has
+   been free for long enough. */
 
-   /* Coalesce the new chunk and the previous one if appropriate. */
-   oPrevChunkInMemory = Chunk_getPrevInMem(oChunk, oHeapStart);
-   if ((oPrevChunkInMemory != NULL) 
-   	&& (Chunk_getStatus(oPrevChunkInMemory) == CHUNK_FREE))
+static void HeapMgr_purgeTree(Chunk_T oRoot)
+{
+   while (oRoot != NULL)
    {
+      HeapMgr_purgeChunk(oRoot);
+      HeapMgr_purgeTree(Chunk_getLeftInTree(oRoot));
+      oRoot = Chunk_getRightInTree(oRoot);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Read the clock. If at least half of PURGE_DECAY_MS has passed since
+   the last purge, purge the pages of the top chunk, unless it holds a
+   reservation, and of every binned chunk that has been free for at
+   least PURGE_DECAY_MS. Only the bins that can hold a chunk large
+   enough to be purged are visited. */
+
+static void HeapMgr_decay(void)
+{
+   struct timespec sNow;
+   int iBin;
+
+   if (clock_gettime(CLOCK_MONOTONIC, &sNow) == -1)
+      return;
+   uPurgeNow = (size_t)sNow.tv_sec * 1000
+      + (size_t)sNow.tv_nsec / 1000000;
+   if (uPurgeNow < uLastPurge + PURGE_DECAY_MS / 2)
+      return;
+   uLastPurge = uPurgeNow;
+
+   if ((oTop != NULL) && (uReservedBytes == 0))
+      HeapMgr_purgeChunk(oTop);
+   iBin = HeapMgr_findNextBin(
+      Bin_fromUnits(2 * SEGMENT_PAGE_BYTES / Chunk_unitsToBytes(1)));
+   while (iBin != -1)
+   {
+      if (! Bin_isExact(iBin))
+         HeapMgr_purgeTree(bins[iBin]);
+      if (iBin + 1 == BIN_COUNT)
+         break;
+      iBin = HeapMgr_findNextBin(iBin + 1);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the chunk after oChunk in memory, which every chunk but a
+   segment's end chunk has, looking up oChunk's segment for the
+   bound. */
 
-   	/* Remove chunks. */
-   	HeapMgr_remove(oChunk);
-   	HeapMgr_remove(oPrevChunkInMemory);
+static Chunk_T HeapMgr_getNextInMem(Chunk_T oChunk)
+{
+   return Chunk_getNextInMem(oChunk,
+      Segment_getLimit(Segment_fromChunk(oChunk)));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Set the status of oChunk to eStatus. Record it in the header of the
+   next chunk in memory, which may be its segment's end chunk. */
+
+static void HeapMgr_setStatus(Chunk_T oChunk, enum ChunkStatus eStatus)
+{
+   Chunk_setStatus(oChunk, eStatus);
+   Chunk_setPrevStatus(HeapMgr_getNextInMem(oChunk), eStatus);
+}
 
-   	/* Coalesce chunks. */
-   	/* Calculate and set units */
-   	uNewUnits = Chunk_getUnits(oPrevChunkInMemory) 
-   	+ Chunk_getUnits(oChunk);
-   	Chunk_setUnits(oPrevChunkInMemory, uNewUnits);
+/*--------------------------------------------------------------------*/
+
+/* Insert oChunk at the front of its bin, or into the bin's treap if
+   the bin holds a range of sizes, and mark the bin as non-empty in the
+   bin map. */
+
+static void HeapMgr_insert(Chunk_T oChunk)
+{
+   int iBinSize = Bin_fromUnits(Chunk_getUnits(oChunk));
 
-   	/* Insert expanded chunk in correct bin. */
-      iBinSize = (int)Chunk_getUnits(oPrevChunkInMemory);
-      if (iBinSize > BIN_MAX - 1) iBinSize = BIN_MAX - 1;
+   uBinOps++;
 
+   /* Check if the bin holds a range of sizes. */
+   if (! Bin_isExact(iBinSize))
+   {
+      Chunk_setLeftInTree(oChunk, NULL);
+      Chunk_setRightInTree(oChunk, NULL);
+      bins[iBinSize] = HeapMgr_treeInsert(bins[iBinSize], oChunk);
+   }
+   else
+   {
       /* Set pointers. */
       if (bins[iBinSize] != NULL) 
-         Chunk_setPrevInList(bins[iBinSize], oPrevChunkInMemory);
-      Chunk_setNextInList(oPrevChunkInMemory, bins[iBinSize]);
-      bins[iBinSize] = oPrevChunkInMemory;
+         Chunk_setPrevInList(bins[iBinSize], oChunk);
+      Chunk_setNextInList(oChunk, bins[iBinSize]);
+      bins[iBinSize] = oChunk;
       Chunk_setPrevInList(bins[iBinSize], NULL);
-
-   	/* Make oChunk the coalesced chunk. */
-      /* Check if it should now be in max bin */
-      iPrevChunkSize = (int)Chunk_getUnits(oPrevChunkInMemory);
-      if (iPrevChunkSize > BIN_MAX - 1) oChunk = bins[BIN_MAX -1];
-      else oChunk = bins[iPrevChunkSize];
    }
- 
-   return oChunk;
+
+   /* Set the bin's bit, and the bit of its bin map word. */
+   aulBinMap[iBinSize / BITS_PER_WORD] |=
+      1UL << (iBinSize % BITS_PER_WORD);
+   ulBinMapSummary |= 1UL << (iBinSize / BITS_PER_WORD);
 }
 
 /*--------------------------------------------------------------------*/
@@ -141,20 +703,43 @@ static Chunk_T HeapMgr_getMoreMemory(size_t uUnits)
 /* Remove oChunk from free list. */
 static void HeapMgr_remove(Chunk_T oChunk)
 {
-	Chunk_T oPrevChunk = Chunk_getPrevInList(oChunk);
-	Chunk_T oNextChunk = Chunk_getNextInList(oChunk);
-   int iBinSize = (int)Chunk_getUnits(oChunk);
+	Chunk_T oPrevChunk;
+	Chunk_T oNextChunk;
+   int iBinSize = Bin_fromUnits(Chunk_getUnits(oChunk));
+   int iWord;
 
-   /* Check if current bin size is larger than maximum. */
-   if (iBinSize > BIN_MAX - 1) iBinSize = BIN_MAX - 1;
+   uBinOps++;
 
-	/* Make oFreeList NULL if oChunk is the last chunk in list. */
+   /* Check if the bin holds a range of sizes, in which case oChunk is
+      in the bin's treap rather than a list. */
+   if (! Bin_isExact(iBinSize))
+   {
+      bins[iBinSize] = HeapMgr_treeRemove(bins[iBinSize], oChunk);
+      oPrevChunk = NULL;
+      oNextChunk = bins[iBinSize];
+   }
+   else
+   {
+      oPrevChunk = Chunk_getPrevInList(oChunk);
+      oNextChunk = Chunk_getNextInList(oChunk);
+   }
+
+	/* Make oFreeList NULL if oChunk is the last chunk in list, and
+	   clear the bin's bits in the bin map. */
 	if ((oNextChunk == NULL) && (oPrevChunk == NULL))
 	{
 		bins[iBinSize] = NULL;
+		iWord = iBinSize / BITS_PER_WORD;
+		aulBinMap[iWord] &= ~(1UL << (iBinSize % BITS_PER_WORD));
+		if (aulBinMap[iWord] == 0)
+			ulBinMapSummary &= ~(1UL << iWord);
 		return;
 	}
 
+	/* The treap is already repaired. */
+	if (! Bin_isExact(iBinSize))
+		return;
+
 	/* If the is no previous chunk, then oChunk is being removed from
 	   the front of the list, so make oFreeList the next chunk. */
 	if (oPrevChunk == NULL) 
@@ -183,6 +768,247 @@ static void HeapMgr_remove(Chunk_T oChunk)
 
 /*--------------------------------------------------------------------*/
 
+/* Free oChunk, which is in use. Merge it with the next and previous
+   chunks in memory if they are free, removing them from their bins.
+   If the resulting chunk is the last in memory, make it the top chunk,
+   and otherwise insert it into its bin once. */
+
+static void HeapMgr_release(Chunk_T oChunk)
+{
+   Segment_T oSegment = Segment_fromChunk(oChunk);
+   Chunk_T oNextChunk;
+   Chunk_T oPrevChunk;
+   size_t uUnits = Chunk_getUnits(oChunk);
+   int bIsTop = FALSE;
+
+   /* Absorb the next chunk in memory if it is free. The top chunk is
+      in no bin. A chunk that ends the newest segment becomes the top
+      chunk. */
+   oNextChunk = Chunk_getNextInMem(oChunk, Segment_getLimit(oSegment));
+   if ((Chunk_getStatus(oNextChunk) == CHUNK_FREE)
+      && (uUnits + Chunk_getUnits(oNextChunk) <= MAX_UNITS_PER_CHUNK))
+   {
+      if (oNextChunk == oTop)
+         bIsTop = TRUE;
+      else
+         HeapMgr_remove(oNextChunk);
+      uUnits += Chunk_getUnits(oNextChunk);
+   }
+   else if (oNextChunk == Segment_getEnd(Segment_getFirst()))
+      bIsTop = TRUE;
+
+   /* Let the previous chunk in memory absorb oChunk if it is free.
+      Only a free previous chunk has a footer by which to find it, and
+      the segment's first sentinel is in use. */
+   if (Chunk_getPrevStatus(oChunk) == CHUNK_FREE)
+   {
+      oPrevChunk = Chunk_getPrevInMem(oChunk,
+         Segment_getFirstChunk(oSegment));
+      if (Chunk_getUnits(oPrevChunk) + uUnits <= MAX_UNITS_PER_CHUNK)
+      {
+         HeapMgr_remove(oPrevChunk);
+         uUnits += Chunk_getUnits(oPrevChunk);
+         oChunk = oPrevChunk;
+      }
+   }
+
+   /* Return a segment other than the newest to the OS once it is
+      wholly free. */
+   if ((! bIsTop) && (oChunk == Segment_getFirstChunk(oSegment))
+      && ((Chunk_T)((char*)oChunk + Chunk_unitsToBytes(uUnits))
+         == Segment_getEnd(oSegment)))
+   {
+      Segment_free(oSegment);
+      return;
+   }
+
+   /* Mark the merged chunk free, which writes its footer, and make it
+      the top chunk or insert it in its bin. Some of its pages are now
+      in use, so it is no longer purged, nor zero. */
+   Chunk_setUnits(oChunk, uUnits);
+   HeapMgr_setStatus(oChunk, CHUNK_FREE);
+   Chunk_setPurged(oChunk, FALSE);
+   Chunk_setZero(oChunk, FALSE);
+   HeapMgr_setFreeTime(oChunk, uPurgeNow);
+   if (bIsTop)
+      oTop = oChunk;
+   else
+      HeapMgr_insert(oChunk);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Use the bin map to find the first non-empty bin at or after iBin
+   without touching the bins themselves. Return its index, or -1 if
+   every such bin is empty. */
+
+static int HeapMgr_findNextBin(int iBin)
+{
+   int iWord;
+   unsigned long ulBits;
+
+   assert(iBin >= 0);
+   assert(iBin < BIN_COUNT);
+
+   /* Look for a non-empty bin in iBin's own bin map word. */
+   iWord = iBin / BITS_PER_WORD;
+   ulBits = aulBinMap[iWord] & (~0UL << (iBin % BITS_PER_WORD));
+   if (ulBits != 0)
+      return (iWord * BITS_PER_WORD) + __builtin_ctzl(ulBits);
+
+   /* Otherwise use the summary to find the next non-empty word. */
+   if (iWord + 1 >= BIN_MAP_WORDS)
+      return -1;
+   ulBits = ulBinMapSummary & (~0UL << (iWord + 1));
+   if (ulBits == 0)
+      return -1;
+   iWord = __builtin_ctzl(ulBits);
+   return (iWord * BITS_PER_WORD) + __builtin_ctzl(aulBinMap[iWord]);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the treap priority of oChunk: a multiplicative hash of its
+   address, so that the treap stays balanced (in expectation) without
+   storing a priority in the chunk. */
+
+static size_t HeapMgr_treePriority(Chunk_T oChunk)
+{
+   return (size_t)((unsigned long)oChunk * 0x9E3779B97F4A7C15UL);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) if oChunk orders before oOtherChunk in the treap,
+   that is, if it is smaller or equally large at a lower address, or
+   0 (FALSE) otherwise. */
+
+static int HeapMgr_treeIsBefore(Chunk_T oChunk, Chunk_T oOtherChunk)
+{
+   size_t uUnits = Chunk_getUnits(oChunk);
+   size_t uOtherUnits = Chunk_getUnits(oOtherChunk);
+
+   if (uUnits != uOtherUnits)
+      return uUnits < uOtherUnits;
+   return oChunk < oOtherChunk;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Insert oChunk, whose children must be NULL, into the treap rooted
+   at oRoot. Rotate it up past any ancestor of lower priority. Return
+   the new root. */
+
+static Chunk_T HeapMgr_treeInsert(Chunk_T oRoot, Chunk_T oChunk)
+{
+   Chunk_T oChild;
+
+   if (oRoot == NULL)
+      return oChunk;
+
+   if (HeapMgr_treeIsBefore(oChunk, oRoot))
+   {
+      oChild = HeapMgr_treeInsert(Chunk_getLeftInTree(oRoot), oChunk);
+      Chunk_setLeftInTree(oRoot, oChild);
+
+      /* Rotate right if the child outranks oRoot. */
+      if (HeapMgr_treePriority(oChild) > HeapMgr_treePriority(oRoot))
+      {
+         Chunk_setLeftInTree(oRoot, Chunk_getRightInTree(oChild));
+         Chunk_setRightInTree(oChild, oRoot);
+         return oChild;
+      }
+   }
+   else
+   {
+      oChild = HeapMgr_treeInsert(Chunk_getRightInTree(oRoot), oChunk);
+      Chunk_setRightInTree(oRoot, oChild);
+
+      /* Rotate left if the child outranks oRoot. */
+      if (HeapMgr_treePriority(oChild) > HeapMgr_treePriority(oRoot))
+      {
+         Chunk_setRightInTree(oRoot, Chunk_getLeftInTree(oChild));
+         Chunk_setLeftInTree(oChild, oRoot);
+         return oChild;
+      }
+   }
+
+   return oRoot;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Merge the treaps rooted at oLeft and oRight, where every chunk of
+   oLeft orders before every chunk of oRight, taking the root of higher
+   priority at each step. Return the root of the merged treap. */
+
+static Chunk_T HeapMgr_treeMerge(Chunk_T oLeft, Chunk_T oRight)
+{
+   if (oLeft == NULL)
+      return oRight;
+   if (oRight == NULL)
+      return oLeft;
+
+   if (HeapMgr_treePriority(oLeft) > HeapMgr_treePriority(oRight))
+   {
+      Chunk_setRightInTree(oLeft,
+         HeapMgr_treeMerge(Chunk_getRightInTree(oLeft), oRight));
+      return oLeft;
+   }
+   Chunk_setLeftInTree(oRight,
+      HeapMgr_treeMerge(oLeft, Chunk_getLeftInTree(oRight)));
+   return oRight;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Remove oChunk, which must be in the treap rooted at oRoot, by
+   finding it by key and merging its two subtrees in its place.
+   Return the new root. */
+
+static Chunk_T HeapMgr_treeRemove(Chunk_T oRoot, Chunk_T oChunk)
+{
+   assert(oRoot != NULL);
+
+   if (oRoot == oChunk)
+      return HeapMgr_treeMerge(Chunk_getLeftInTree(oChunk),
+         Chunk_getRightInTree(oChunk));
+
+   if (HeapMgr_treeIsBefore(oChunk, oRoot))
+      Chunk_setLeftInTree(oRoot,
+         HeapMgr_treeRemove(Chunk_getLeftInTree(oRoot), oChunk));
+   else
+      Chunk_setRightInTree(oRoot,
+         HeapMgr_treeRemove(Chunk_getRightInTree(oRoot), oChunk));
+   return oRoot;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the smallest chunk of at least uUnits units in the treap
+   rooted at oRoot, breaking ties by address, or NULL if there is no
+   such chunk. */
+
+static Chunk_T HeapMgr_treeFindBestFit(Chunk_T oRoot, size_t uUnits)
+{
+   Chunk_T oBest = NULL;
+
+   while (oRoot != NULL)
+   {
+      if (Chunk_getUnits(oRoot) >= uUnits)
+      {
+         oBest = oRoot;
+         oRoot = Chunk_getLeftInTree(oRoot);
+      }
+      else
+         oRoot = Chunk_getRightInTree(oRoot);
+   }
+
+   return oBest;
+}
+
+/*--------------------------------------------------------------------*/
+
 /* If oChunk is close to the right size (as specified by uUnits),
    then splice oChunk out of the free list (using oPrevChunk to do
    so), and return oChunk. If oChunk is too big, split it and return
@@ -193,11 +1019,17 @@ static Chunk_T HeapMgr_useChunk(Chunk_T oChunk, size_t uUnits)
    Chunk_T oNewChunk;
    size_t uChunkUnits;
    size_t newChunkUnits;
-   int iBinSize;
+   size_t uTime;
+   int bPurged;
+   int bZero;
 
-   assert(Checker_isValid(oHeapStart, oHeapEnd, bins, BIN_MAX));
+   assert(HeapMgr_isValid());
 
    uChunkUnits = Chunk_getUnits(oChunk);
+   uTime = HeapMgr_getFreeTime(oChunk);
+   bPurged = Chunk_isPurged(oChunk);
+   bZero = Chunk_isZero(oChunk);
+   Chunk_setPurged(oChunk, FALSE);
 
    /* Remove oChunk from free list */
    HeapMgr_remove(oChunk);
@@ -205,7 +1037,7 @@ static Chunk_T HeapMgr_useChunk(Chunk_T oChunk, size_t uUnits)
    /* If oChunk is close to the right size, then use it. */
    if (uChunkUnits < uUnits + MIN_UNITS_PER_CHUNK)
    {
-      Chunk_setStatus(oChunk, CHUNK_INUSE);
+      HeapMgr_setStatus(oChunk, CHUNK_INUSE);
       return oChunk;
    }
 
@@ -214,25 +1046,25 @@ static Chunk_T HeapMgr_useChunk(Chunk_T oChunk, size_t uUnits)
    /* Calculate units of new chunk. */
    newChunkUnits = uChunkUnits - uUnits;
    Chunk_setUnits(oChunk, uUnits);
-   oNewChunk = Chunk_getNextInMem(oChunk, oHeapEnd);
+   oNewChunk = HeapMgr_getNextInMem(oChunk);
    Chunk_setUnits(oNewChunk, newChunkUnits);
 
-   /* Set statuses of chunks */
+   /* Set statuses of chunks. The chunk after the tail end already
+      records that its previous chunk is free. The tail end's pages are
+      still purged if oChunk's were, and both ends are still zero if
+      oChunk was. */
    Chunk_setStatus(oChunk, CHUNK_INUSE);
    Chunk_setStatus(oNewChunk, CHUNK_FREE);
+   Chunk_setPrevStatus(oNewChunk, CHUNK_INUSE);
+   Chunk_setMapped(oNewChunk, FALSE);
+   Chunk_setPurged(oNewChunk, bPurged);
+   Chunk_setZero(oNewChunk, bZero);
+   HeapMgr_setFreeTime(oNewChunk, uTime);
 
-   /* Insert expanded chunk in correct bin. */
-      iBinSize = (int)Chunk_getUnits(oNewChunk);
-      if (iBinSize > BIN_MAX - 1) iBinSize = BIN_MAX - 1;
+   /* Insert the tail end in correct bin. */
+   HeapMgr_insert(oNewChunk);
 
-      /* Set pointers. */
-      if (bins[iBinSize] != NULL) 
-         Chunk_setPrevInList(bins[iBinSize], oNewChunk);
-      Chunk_setNextInList(oNewChunk, bins[iBinSize]);
-      bins[iBinSize] = oNewChunk;
-      Chunk_setPrevInList(bins[iBinSize], NULL);
-
-      return oChunk;
+   return oChunk;
 }
 
 /*--------------------------------------------------------------------*/
@@ -245,56 +1077,226 @@ static Chunk_T HeapMgr_findUsableChunk(size_t uUnits)
    int startBin;
    int currentBin;
 
-   oChunk = NULL;
+   /* Find the right bin to start with. If it holds a range of sizes,
+      take the best fit in its treap, if there is one. */
+   startBin = Bin_fromUnits(uUnits);
+   if (! Bin_isExact(startBin))
+   {
+      oChunk = HeapMgr_treeFindBestFit(bins[startBin], uUnits);
+      if (oChunk != NULL)
+         return oChunk;
+      if (startBin == BIN_COUNT - 1)
+         return NULL;
+      startBin++;
+   }
+
+   /* Find the first non-empty bin at or after the start bin. Every
+      chunk in it is large enough: an exact bin's front chunk will do,
+      and otherwise the smallest chunk in the bin's treap. */
+   currentBin = HeapMgr_findNextBin(startBin);
+   if (currentBin == -1)
+      return NULL;
+   if (Bin_isExact(currentBin))
+      return bins[currentBin];
+   return HeapMgr_treeFindBestFit(bins[currentBin], uUnits);
+}
+
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes that the payload of oChunk, which is in
+   use, can hold: all of the chunk after its header. */
+
+static size_t HeapMgr_getPayloadBytes(Chunk_T oChunk)
+{
+   size_t uUnits;
+
+   /* A mapped chunk's header may record fewer units than it has. */
+   if (Chunk_isMapped(oChunk))
+      uUnits = Large_getUnits(oChunk);
+   else
+      uUnits = Chunk_getUnits(oChunk);
+   return Chunk_unitsToBytes(uUnits)
+      - (size_t)((char*)Chunk_toPayload(oChunk) - (char*)oChunk);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Shrink oChunk, which is in use, to uUnits units if the rest would
+   make a chunk, and release the rest as a chunk of its own, which
+   coalesces with the next chunk in memory if that is free. */
+
+static void HeapMgr_shrinkChunk(Chunk_T oChunk, size_t uUnits)
+{
+   Chunk_T oTailChunk;
+   size_t uChunkUnits = Chunk_getUnits(oChunk);
+
+   assert(Chunk_getStatus(oChunk) == CHUNK_INUSE);
+   assert(uUnits <= uChunkUnits);
+
+   if (uChunkUnits < uUnits + MIN_UNITS_PER_CHUNK)
+      return;
+
+   /* Make the tail end a chunk in use, so that it gets no footer, and
+      release it. */
+   Chunk_setUnits(oChunk, uUnits);
+   oTailChunk = HeapMgr_getNextInMem(oChunk);
+   Chunk_setUnits(oTailChunk, uChunkUnits - uUnits);
+   Chunk_setStatus(oTailChunk, CHUNK_INUSE);
+   Chunk_setPrevStatus(oTailChunk, CHUNK_INUSE);
+   Chunk_setMapped(oTailChunk, FALSE);
+   Chunk_setPurged(oTailChunk, FALSE);
+   Chunk_setZero(oTailChunk, FALSE);
+   HeapMgr_release(oTailChunk);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Grow oChunk, which is in use, to at least uUnits units in place, by
+   absorbing the next chunk in memory if it is free and large enough.
+   If the next chunk is the top chunk, or oChunk ends the newest
+   segment, grow the heap first if need be. Split off and release any
+   excess. Return TRUE if successful, and FALSE otherwise. */
+
+static int HeapMgr_growChunk(Chunk_T oChunk, size_t uUnits)
+{
+   Chunk_T oNextChunk;
+   size_t uChunkUnits = Chunk_getUnits(oChunk);
+   size_t uNextUnits;
+   size_t uTime;
+   int bPurged;
+   int bZero;
+
+   assert(Chunk_getStatus(oChunk) == CHUNK_INUSE);
+   assert(uUnits > uChunkUnits);
+
+   oNextChunk = HeapMgr_getNextInMem(oChunk);
+
+   /* Make the top chunk large enough, if it follows oChunk. The heap
+      may grow into a new segment instead, which leaves oChunk where it
+      is. */
+   if ((oNextChunk == Segment_getEnd(Segment_getFirst()))
+      || ((oNextChunk == oTop)
+         && (uChunkUnits + Chunk_getUnits(oTop) < uUnits)))
+   {
+      if (HeapMgr_getMoreMemory(uUnits - uChunkUnits) == NULL)
+         return FALSE;
+      oNextChunk = HeapMgr_getNextInMem(oChunk);
+   }
 
-   /* Find the right bin in integer form to start with, or max if it 
-      is sufficiently large. */
-   startBin = (int) uUnits;
-   if (startBin > BIN_MAX - 1) startBin = BIN_MAX - 1;
+   if ((Chunk_getStatus(oNextChunk) != CHUNK_FREE)
+      || (uChunkUnits + Chunk_getUnits(oNextChunk) < uUnits)
+      || (uChunkUnits + Chunk_getUnits(oNextChunk)
+         > MAX_UNITS_PER_CHUNK))
+      return FALSE;
 
-   /* Starting with the start bin, go through each bin until a usable
-      chunk is found. */
-   currentBin = startBin;
-   while (currentBin < BIN_MAX)
+   /* Carve the units needed from the front of the top chunk, as
+      HeapMgr_useTop does. */
+   uNextUnits = Chunk_getUnits(oNextChunk);
+   if (oNextChunk == oTop)
    {
-      /* Set oChunk. */
-      oChunk = bins[currentBin];
-      while (oChunk != NULL)
+      oTop = NULL;
+      if (uChunkUnits + uNextUnits >= uUnits + MIN_UNITS_PER_CHUNK)
       {
-         if (Chunk_getUnits(oChunk) >= uUnits) return oChunk;
-         oChunk = Chunk_getNextInList(oChunk);
+         uTime = HeapMgr_getFreeTime(oNextChunk);
+         bPurged = Chunk_isPurged(oNextChunk);
+         bZero = Chunk_isZero(oNextChunk);
+         Chunk_setUnits(oChunk, uUnits);
+         oTop = HeapMgr_getNextInMem(oChunk);
+         Chunk_setUnits(oTop, uChunkUnits + uNextUnits - uUnits);
+         Chunk_setStatus(oTop, CHUNK_FREE);
+         Chunk_setPrevStatus(oTop, CHUNK_INUSE);
+         Chunk_setMapped(oTop, FALSE);
+         Chunk_setPurged(oTop, bPurged);
+         Chunk_setZero(oTop, bZero);
+         HeapMgr_setFreeTime(oTop, uTime);
+         return TRUE;
       }
-      currentBin++;
    }
-return oChunk;
+   else
+      HeapMgr_remove(oNextChunk);
+
+   /* Absorb the whole next chunk, and release any excess. */
+   Chunk_setUnits(oChunk, uChunkUnits + uNextUnits);
+   HeapMgr_setStatus(oChunk, CHUNK_INUSE);
+   HeapMgr_shrinkChunk(oChunk, uUnits);
+   return TRUE;
 }
 
+/*--------------------------------------------------------------------*/
+
+/* Set the uBytes bytes at pv to zero. If there are at least
+   ZERO_STREAM_BYTES of them, and SSE2 is available, zero the whole
+   cache lines among them with non-temporal stores, and the rest with
+   memset. */
+
+static void HeapMgr_zero(void *pv, size_t uBytes)
+{
+   char *pc = (char*)pv;
+#ifdef __SSE2__
+   enum {LINE_BYTES = 64};
+   char *pcEnd = pc + uBytes;
+   size_t uHeadBytes;
+   __m128i xZero;
+
+   if (uBytes >= ZERO_STREAM_BYTES)
+   {
+      uHeadBytes = (LINE_BYTES - (uintptr_t)pc % LINE_BYTES)
+         % LINE_BYTES;
+      memset(pc, 0, uHeadBytes);
+      pc += uHeadBytes;
+      xZero = _mm_setzero_si128();
+      for (; pc + LINE_BYTES <= pcEnd; pc += LINE_BYTES)
+      {
+         _mm_stream_si128((__m128i*)pc, xZero);
+         _mm_stream_si128((__m128i*)(pc + 16), xZero);
+         _mm_stream_si128((__m128i*)(pc + 32), xZero);
+         _mm_stream_si128((__m128i*)(pc + 48), xZero);
+      }
+
+      /* Order the non-temporal stores before any that follow. */
+      _mm_sfence();
+      uBytes = (size_t)(pcEnd - pc);
+   }
+#endif
+   memset(pc, 0, uBytes);
+}
 
 /*--------------------------------------------------------------------*/
 
-void *HeapMgr_malloc(size_t uBytes)
+/* Return a chunk of at least uUnits units in use, reusing one from
+   its fast bin or a bin if possible, and otherwise carving it from the
+   top chunk, or NULL if the OS refused. The heap must have a
+   segment. */
+
+static Chunk_T HeapMgr_allocChunk(size_t uUnits)
 {
    Chunk_T oChunk;
-   size_t uUnits;
 
-   if (uBytes == 0)
-      return NULL;
+   assert(uUnits >= MIN_UNITS_PER_CHUNK);
+   assert(uUnits <= MAX_UNITS_PER_CHUNK);
 
-   /* Step 1: Initialize the heap manager if this is the first call. */
-   if (oHeapStart == NULL)
+   /* Reuse a chunk of exactly uUnits from its fast bin, if there is
+      one. It is still in use. */
+   if ((uUnits <= FAST_MAX_UNITS) && (aoFastBins[uUnits] != NULL))
    {
-      oHeapStart = (Chunk_T)sbrk(0);
-      oHeapEnd = oHeapStart;
+      oChunk = aoFastBins[uUnits];
+      aoFastBins[uUnits] = Chunk_getNextInList(oChunk);
+      uFastCount--;
+      assert(HeapMgr_isValid());
+      return oChunk;
    }
 
-   assert(Checker_isValid(oHeapStart, oHeapEnd, bins, BIN_MAX));
-
-   /* Step 2: Determine the number of units the new chunk should
-      contain. */
-   uUnits = Chunk_bytesToUnits(uBytes);
-
-   /* Find a usable chunk for uUnits */
+   /* Find a usable chunk for uUnits. If there is none, and the top
+      chunk is too small, coalesce the chunks in the fast bins, and try
+      again. */
    oChunk = HeapMgr_findUsableChunk(uUnits);
+   if ((oChunk == NULL) && (uFastCount != 0)
+      && ((oTop == NULL) || (Chunk_getUnits(oTop) < uUnits)))
+   {
+      HeapMgr_consolidate();
+      oChunk = HeapMgr_findUsableChunk(uUnits);
+   }
 
    /* If a usable chunk was found, use it! */
    if (oChunk != NULL) 
@@ -302,27 +1304,102 @@ void *HeapMgr_malloc(size_t uBytes)
       oChunk = HeapMgr_useChunk(oChunk, uUnits);
 
       /* Check validity */
-      assert(Checker_isValid(oHeapStart, oHeapEnd, bins, BIN_MAX));
+      assert(HeapMgr_isValid());
+
+      return oChunk;
+   }
+
+   /* If no usable chunk was found, carve one from the top chunk,
+      first asking the OS for more memory to extend the top chunk if it
+      is too small. */
+   if ((oTop == NULL) || (Chunk_getUnits(oTop) < uUnits))
+   {
+      if (HeapMgr_getMoreMemory(uUnits) == NULL)
+      {
+         assert(HeapMgr_isValid());
+         return NULL;
+      }
+   }
+   oChunk = HeapMgr_useTop(uUnits);
+   assert(HeapMgr_isValid());
+   return oChunk;
+}
+
+/*--------------------------------------------------------------------*/
+
+#ifdef HEAPMGR_PREZERO
+/* Free every chunk that the zero pool has given back, which is still
+   in use. */
 
-      /* Retuen payload of oChunk. */
-      return Chunk_toPayload(oChunk); 
+static void HeapMgr_drainZeroPool(void)
+{
+   Chunk_T oChunk;
+
+   while ((oChunk = ZeroPool_evict()) != NULL)
+      HeapMgr_release(oChunk);
+}
+#endif
+
+/*--------------------------------------------------------------------*/
+
+void *HeapMgr_malloc(size_t uBytes)
+{
+   Chunk_T oChunk;
+   void *pv;
+   size_t uUnits;
+
+   if (uBytes == 0)
+      return NULL;
+
+   /* Serve small requests from the slabs. */
+   if (uBytes <= SLAB_MAX_BYTES)
+   {
+      pv = Slab_alloc(uBytes);
+      assert(Slab_isValid());
+      return pv;
    }
 
+   /* Step 1: Initialize the heap manager if this is the first call. */
+   if (Segment_getFirst() == NULL)
+   {
+      if (Segment_new(0) == NULL)
+         return NULL;
+      HeapMgr_decay();
+   }
 
-   /* If no usable chunk was found, ask the OS for more memory, and 
-      create a new chunk (or expand the existing chunk) at the front
-      of the appropriate bin. */
-   oChunk =  HeapMgr_getMoreMemory(uUnits);
-   if (oChunk == NULL)
+   assert(HeapMgr_isValid());
+
+   /* Step 2: Determine the number of units the new chunk should
+      contain. */
+   uUnits = Chunk_bytesToUnits(uBytes);
+   if (uUnits == 0)
    {
-      assert(Checker_isValid(oHeapStart, oHeapEnd, bins, BIN_MAX));
+      assert(HeapMgr_isValid());
       return NULL;
    }
 
-   /* Step 5: oChunk is big enough, so use it. (Now it should be
-      big enough!) */
-   oChunk = HeapMgr_useChunk(oChunk, uUnits);
-   assert(Checker_isValid(oHeapStart, oHeapEnd, bins, BIN_MAX));
+   /* Serve a large request from a mapped chunk, or from the heap if
+      the OS refuses. */
+   if (Chunk_unitsToBytes(uUnits) > Large_getThreshold())
+   {
+      oChunk = Large_alloc(uUnits);
+      if (oChunk != NULL)
+      {
+         assert(HeapMgr_isValid());
+         return Chunk_toPayload(oChunk);
+      }
+   }
+
+   /* Serve any other request from the heap, which cannot hold a chunk
+      larger than MAX_UNITS_PER_CHUNK. */
+   if (uUnits > MAX_UNITS_PER_CHUNK)
+   {
+      assert(HeapMgr_isValid());
+      return NULL;
+   }
+   oChunk = HeapMgr_allocChunk(uUnits);
+   if (oChunk == NULL)
+      return NULL;
    return Chunk_toPayload(oChunk);
 }
 
@@ -330,89 +1407,509 @@ void *HeapMgr_malloc(size_t uBytes)
 
 void HeapMgr_free(void *pv)
 {
+   enum PageKind eKind;
+   Segment_T oSegment;
    Chunk_T oChunk;
+#ifdef HEAPMGR_PREZERO
    Chunk_T oNextChunk;
-   Chunk_T oPrevChunk;
-   int iBinSize;
+#endif
+   size_t uUnits;
+   size_t uKeepBytes;
 
    assert(pv != NULL);
 
-   assert(Checker_isValid(oHeapStart, oHeapEnd, bins, BIN_MAX));
-
    if (pv == NULL)
       return;
 
+   /* Look up what kind of memory holds pv. Objects in slabs have no
+      chunk header, and a pointer into memory that the HeapMgr does not
+      manage is ignored. */
+   eKind = PageMap_getKind(pv);
+   if (eKind == PAGE_SLAB)
+   {
+      Slab_free(pv);
+      assert(Slab_isValid());
+      return;
+   }
+
+   /* A mapped chunk owns the first page of its mapping. */
+   if (eKind == PAGE_LARGE)
+   {
+      oChunk = (Chunk_T)PageMap_getOwner(pv);
+      if (Chunk_toPayload(oChunk) == pv)
+         Large_free(oChunk);
+      assert(Large_isValid());
+      return;
+   }
+   if (eKind != PAGE_HEAP)
+      return;
+   oSegment = (Segment_T)PageMap_getOwner(pv);
+   if (((Chunk_T)pv <= Segment_getFirstChunk(oSegment))
+      || ((Chunk_T)pv >= Segment_getEnd(oSegment)))
+      return;
+
+   assert(HeapMgr_isValid());
+
+   /* The chunk's payload has been used, so it is no longer zero. */
    oChunk = Chunk_fromPayload(pv);
+   uUnits = Chunk_getUnits(oChunk);
+   Chunk_setZero(oChunk, FALSE);
+   uChunkFrees++;
+
+   /* Now and then, purge the pages of chunks left free too long. */
+   if (uChunkFrees % PURGE_CHECK_FREES == 0)
+      HeapMgr_decay();
+
+#ifdef HEAPMGR_PREZERO
+   /* Let the zero pool have a chunk of a size often allocated zeroed,
+      which its thread zeroes, after freeing the chunks that it has
+      given back. A chunk small enough for a fast bin is not offered,
+      so that its free takes no lock, nor is one that ends the heap or
+      a segment, which the pool would keep from being returned to the
+      OS. A pool that HeapMgr_calloc has stopped consulting would only
+      keep memory from being returned, so after PREZERO_IDLE_FREES
+      chunks it gives back its reserve and is offered no more until
+      HeapMgr_calloc consults it again. */
+   if ((uUnits > FAST_MAX_UNITS)
+      && (Chunk_unitsToBytes(uUnits) >= PREZERO_MIN_BYTES)
+      && (uPrezeroIdleFrees < PREZERO_IDLE_FREES))
+   {
+      uPrezeroIdleFrees++;
+      if (uPrezeroIdleFrees == PREZERO_IDLE_FREES)
+         ZeroPool_flush();
+      HeapMgr_drainZeroPool();
+      oNextChunk = HeapMgr_getNextInMem(oChunk);
+      if ((uPrezeroIdleFrees < PREZERO_IDLE_FREES)
+         && (oNextChunk != oTop)
+         && (oNextChunk != Segment_getEnd(oSegment))
+         && ZeroPool_give(oChunk))
+      {
+         assert(HeapMgr_isValid());
+         return;
+      }
+   }
+#endif
+
+   /* Put a small chunk in its fast bin without coalescing it. */
+   if (uUnits <= FAST_MAX_UNITS)
+   {
+      Chunk_setNextInList(oChunk, aoFastBins[uUnits]);
+      aoFastBins[uUnits] = oChunk;
+      uFastCount++;
+      assert(HeapMgr_isValid());
+      return;
+   }
 
+   HeapMgr_release(oChunk);
+
+   /* Releasing a large chunk is a sign that the fast bins may be
+      keeping large free chunks apart, so consolidate them. */
+   if (uUnits >= FAST_CONSOLIDATE_UNITS)
+      HeapMgr_consolidate();
+
+   /* Return memory to the OS if the top chunk has grown too large,
+      keeping enough for the next growth and any reservation. */
+   uKeepBytes = TRIM_KEEP_BYTES;
+   if (uKeepBytes < HeapMgr_getGrowBytes())
+      uKeepBytes = HeapMgr_getGrowBytes();
+   if (uKeepBytes < uReservedBytes)
+      uKeepBytes = uReservedBytes;
+   if ((oTop != NULL)
+      && (Chunk_unitsToBytes(Chunk_getUnits(oTop))
+         > TRIM_THRESHOLD_BYTES)
+      && (Chunk_unitsToBytes(Chunk_getUnits(oTop))
+         > 2 * Large_getThreshold())
+      && (Chunk_unitsToBytes(Chunk_getUnits(oTop)) > 2 * uKeepBytes))
+      HeapMgr_trimTop(uKeepBytes);
+
+   assert(HeapMgr_isValid());
+}
 
-   /* Insert given chunk in its corresponding bin. */
-   iBinSize = (int)Chunk_getUnits(oChunk);
-   if (iBinSize > BIN_MAX - 1) iBinSize = BIN_MAX - 1;
+/*--------------------------------------------------------------------*/
 
-   /* Set pointers. */
-   if (bins[iBinSize] != NULL) 
-      Chunk_setPrevInList(bins[iBinSize], oChunk);
-   Chunk_setNextInList(oChunk, bins[iBinSize]);
-   bins[iBinSize] = oChunk;
-   Chunk_setPrevInList(bins[iBinSize], NULL);
+void *HeapMgr_realloc(void *pv, size_t uBytes)
+{
+   enum PageKind eKind;
+   Segment_T oSegment;
+   Chunk_T oChunk = NULL;
+   size_t uOldBytes;
+   size_t uOldUnits;
+   size_t uUnits;
+   void *pvNew;
 
-   /* Set staus of given chunk to free. */
-   Chunk_setStatus(oChunk, CHUNK_FREE);
+   if (pv == NULL)
+      return HeapMgr_malloc(uBytes);
+   if (uBytes == 0)
+   {
+      HeapMgr_free(pv);
+      return NULL;
+   }
 
+   /* Find how much pv can hold. A pointer into memory that the HeapMgr
+      does not manage is refused. */
+   eKind = PageMap_getKind(pv);
+   if (eKind == PAGE_SLAB)
+      uOldBytes = Slab_getSize(pv);
+   else if (eKind == PAGE_LARGE)
+   {
+      oChunk = (Chunk_T)PageMap_getOwner(pv);
+      if (Chunk_toPayload(oChunk) != pv)
+         return NULL;
+      uOldBytes = HeapMgr_getPayloadBytes(oChunk);
+   }
+   else if (eKind == PAGE_HEAP)
+   {
+      oSegment = (Segment_T)PageMap_getOwner(pv);
+      if (((Chunk_T)pv <= Segment_getFirstChunk(oSegment))
+         || ((Chunk_T)pv >= Segment_getEnd(oSegment)))
+         return NULL;
+      oChunk = Chunk_fromPayload(pv);
+      uOldBytes = HeapMgr_getPayloadBytes(oChunk);
+   }
+   else
+      return NULL;
+   uReallocs++;
 
-   /* If appropriate, coalesce the given chunk and the next or
-      prev one in memory. */
-   oPrevChunk = Chunk_getPrevInMem(oChunk, oHeapStart);
-   oNextChunk = Chunk_getNextInMem(oChunk, oHeapEnd);
+   /* A block in a slab that is large enough stays where it is. */
+   if ((uBytes <= uOldBytes) && (eKind == PAGE_SLAB))
+      return pv;
 
-   /* Check oNextCHunk... */
-   if ((oNextChunk != NULL)
-     && (Chunk_getStatus(oNextChunk) == CHUNK_FREE)) 
+   /* A mapped chunk that is large enough, and not more than twice as
+      large as needed, stays where it is. Otherwise, if it is to remain
+      mapped, remap its pages, which the OS can move without copying
+      them. */
+   if (eKind == PAGE_LARGE)
    {
+      if ((uBytes <= uOldBytes) && (uBytes > uOldBytes / 2))
+         return pv;
+      uUnits = Chunk_bytesToUnits(uBytes);
+      if (uUnits == 0)
+         return NULL;
+      if (Chunk_unitsToBytes(uUnits) > Large_getThreshold())
+      {
+         uOldUnits = Large_getUnits(oChunk);
+         oChunk = Large_resize(oChunk, uUnits);
+         if (oChunk != NULL)
+         {
+            /* A mapping whose size is unchanged was not remapped. */
+            if (Large_getUnits(oChunk) != uOldUnits)
+               uReallocRemaps++;
+            assert(HeapMgr_isValid());
+            return Chunk_toPayload(oChunk);
+         }
+      }
+   }
 
-      /* Coalesce it if it's free. */
-      HeapMgr_remove(oNextChunk);
-      HeapMgr_remove(oChunk);
+   /* Shrink or grow a heap chunk in place if possible. A chunk that
+      grows beyond the mapping threshold is instead moved to a mapping
+      once, so that it can be remapped as it grows further. */
+   if (eKind == PAGE_HEAP)
+   {
+      assert(HeapMgr_isValid());
+      uUnits = Chunk_bytesToUnits(uBytes);
+      if (uUnits == 0)
+         return NULL;
+      if (uUnits <= Chunk_getUnits(oChunk))
+      {
+         HeapMgr_shrinkChunk(oChunk, uUnits);
+         assert(HeapMgr_isValid());
+         return pv;
+      }
+      if (Chunk_unitsToBytes(uUnits) <= Large_getThreshold())
+      {
+         if (HeapMgr_growChunk(oChunk, uUnits))
+         {
+            assert(HeapMgr_isValid());
+            return pv;
+         }
+
+         /* The next chunk may be in a fast bin, so coalesce the fast
+            bins and try again. */
+         if (uFastCount != 0)
+         {
+            HeapMgr_consolidate();
+            if (HeapMgr_growChunk(oChunk, uUnits))
+            {
+               assert(HeapMgr_isValid());
+               return pv;
+            }
+         }
+      }
+   }
 
-      Chunk_setUnits(oChunk, Chunk_getUnits(oChunk) +
-         Chunk_getUnits(oNextChunk));
+   /* Move the block, copying as much of it as fits. */
+   pvNew = HeapMgr_malloc(uBytes);
+   if (pvNew == NULL)
+      return NULL;
+   if (uOldBytes > uBytes)
+      uOldBytes = uBytes;
+   memcpy(pvNew, pv, uOldBytes);
+   HeapMgr_free(pv);
+   uReallocCopies++;
+   return pvNew;
+}
 
-      /* Insert chunk in corresponding bin. */
-      Chunk_setStatus(oChunk, CHUNK_FREE);
-      iBinSize = (int)Chunk_getUnits(oChunk);
-      if (iBinSize > BIN_MAX - 1) iBinSize = BIN_MAX - 1;
+/*--------------------------------------------------------------------*/
 
-      /* Set pointers. */
-      if (bins[iBinSize] != NULL) 
-         Chunk_setPrevInList(bins[iBinSize], oChunk);
-      Chunk_setNextInList(oChunk, bins[iBinSize]);
-      bins[iBinSize] = oChunk;
-      Chunk_setPrevInList(bins[iBinSize], NULL);
-   } 
+void *HeapMgr_calloc(size_t uCount, size_t uSize)
+{
+   Chunk_T oChunk;
+   void *pv;
+   size_t uBytes;
+   size_t uPayloadBytes;
+
+   /* Refuse a request whose size cannot be represented. */
+   if ((uSize != 0) && (uCount > (size_t)-1 / uSize))
+      return NULL;
+   uBytes = uCount * uSize;
 
-   /* Check oPrevChunk... */
-   if ((oPrevChunk != NULL)
-     && (Chunk_getStatus(oPrevChunk) == CHUNK_FREE)) 
+#ifdef HEAPMGR_PREZERO
+   /* Serve a request of a size often allocated zeroed from the zero
+      pool, and free any chunks that the pool gives back. */
+   if ((uBytes > SLAB_MAX_BYTES) && (Chunk_bytesToUnits(uBytes) != 0))
    {
-         /* Coalesce it if it's free. */
-      HeapMgr_remove(oChunk);
-      HeapMgr_remove(oPrevChunk);
+      uPrezeroIdleFrees = 0;
+      oChunk = ZeroPool_take(Chunk_bytesToUnits(uBytes));
+      HeapMgr_drainZeroPool();
+      if (oChunk != NULL)
+      {
+         uCallocBytes += uBytes;
+         uCallocPrezeroedBytes += uBytes;
+         assert(HeapMgr_isValid());
+         return Chunk_toPayload(oChunk);
+      }
+   }
+#endif
 
-      Chunk_setUnits(oPrevChunk, Chunk_getUnits(oPrevChunk) +
-         Chunk_getUnits(oChunk));
+   pv = HeapMgr_malloc(uBytes);
+   if (pv == NULL)
+      return NULL;
+   uCallocBytes += uBytes;
 
-      /* Insert chunk in correspinding bin. */
-      Chunk_setStatus(oPrevChunk, CHUNK_FREE);
-      iBinSize = (int)Chunk_getUnits(oPrevChunk);
-      if (iBinSize > BIN_MAX - 1) iBinSize = BIN_MAX - 1;
+   /* A chunk that is zero needs zeroing only where a free chunk
+      records its time, its footer and its links. An object in a slab
+      has no chunk, and is small. */
+   if (PageMap_getKind(pv) != PAGE_SLAB)
+   {
+      oChunk = Chunk_fromPayload(pv);
+      if (Chunk_isZero(oChunk))
+      {
+         uPayloadBytes = HeapMgr_getPayloadBytes(oChunk);
+         memset(pv, 0, Chunk_unitsToBytes(1));
+         memset((char*)pv + uPayloadBytes - Chunk_unitsToBytes(1), 0,
+            Chunk_unitsToBytes(1));
+         Chunk_setZero(oChunk, FALSE);
+         return pv;
+      }
+   }
 
-      /* Set pointers. */
-      if (bins[iBinSize] != NULL) 
-         Chunk_setPrevInList(bins[iBinSize], oPrevChunk);
-      Chunk_setNextInList(oPrevChunk, bins[iBinSize]);
-      bins[iBinSize] = oPrevChunk;
-      Chunk_setPrevInList(bins[iBinSize], NULL);
-   } 
+   HeapMgr_zero(pv, uBytes);
+   uCallocZeroedBytes += uBytes;
+   return pv;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *HeapMgr_memalign(size_t uAlignment, size_t uBytes)
+{
+   Chunk_T oChunk;
+   Chunk_T oAlignedChunk;
+   char *pcPayload;
+   size_t uUnits;
+   size_t uAlignUnits;
+   size_t uLeadUnits;
+   size_t uChunkUnits;
+
+   /* Refuse an alignment that is not a power of 2. Every payload has
+      at least the alignment of a unit. */
+   if ((uAlignment == 0) || ((uAlignment & (uAlignment - 1)) != 0))
+      return NULL;
+   if (uAlignment <= Chunk_unitsToBytes(1))
+      return HeapMgr_malloc(uBytes);
+   if (uBytes == 0)
+      return NULL;
+
+   if (Segment_getFirst() == NULL)
+   {
+      if (Segment_new(0) == NULL)
+         return NULL;
+      HeapMgr_decay();
+   }
+
+   assert(HeapMgr_isValid());
+
+   /* Take a chunk from the heap, never from a mapping, with room for
+      the payload at an aligned address preceded by a chunk at least
+      MIN_UNITS_PER_CHUNK units long. */
+   uUnits = Chunk_bytesToUnits(uBytes);
+   uAlignUnits = uAlignment / Chunk_unitsToBytes(1);
+   if ((uUnits == 0)
+      || (uUnits > MAX_UNITS_PER_CHUNK - MIN_UNITS_PER_CHUNK)
+      || (uAlignUnits
+         > MAX_UNITS_PER_CHUNK - MIN_UNITS_PER_CHUNK - uUnits))
+      return NULL;
+   oChunk = HeapMgr_allocChunk(uUnits + uAlignUnits
+      + MIN_UNITS_PER_CHUNK);
+   if (oChunk == NULL)
+      return NULL;
+
+   /* If the chunk's payload is aligned, release the excess beyond the
+      payload. Otherwise find the first aligned payload far enough into
+      the chunk. Since every payload is as far past a multiple of a
+      unit, it is a whole number of units in. */
+   pcPayload = (char*)Chunk_toPayload(oChunk);
+   if ((size_t)pcPayload % uAlignment == 0)
+   {
+      HeapMgr_shrinkChunk(oChunk, uUnits);
+      assert(HeapMgr_isValid());
+      return pcPayload;
+   }
+   pcPayload += uAlignment - (size_t)pcPayload % uAlignment;
+   if ((size_t)(pcPayload - (char*)Chunk_toPayload(oChunk))
+      < Chunk_unitsToBytes(MIN_UNITS_PER_CHUNK))
+      pcPayload += uAlignment;
+
+   /* Make the rest of the chunk, from the aligned payload's header, a
+      chunk in use of its own, and release the leading part, which
+      records in it that it is free. */
+   oAlignedChunk = Chunk_fromPayload(pcPayload);
+   uChunkUnits = Chunk_getUnits(oChunk);
+   uLeadUnits = (size_t)((char*)oAlignedChunk - (char*)oChunk)
+      / Chunk_unitsToBytes(1);
+   assert(uLeadUnits >= MIN_UNITS_PER_CHUNK);
+   assert(uLeadUnits + uUnits <= uChunkUnits);
+   Chunk_setStatus(oAlignedChunk, CHUNK_INUSE);
+   Chunk_setUnits(oAlignedChunk, uChunkUnits - uLeadUnits);
+   Chunk_setPrevStatus(oAlignedChunk, CHUNK_INUSE);
+   Chunk_setMapped(oAlignedChunk, FALSE);
+   Chunk_setPurged(oAlignedChunk, FALSE);
+   Chunk_setZero(oAlignedChunk, FALSE);
+   Chunk_setUnits(oChunk, uLeadUnits);
+   HeapMgr_release(oChunk);
+
+   /* Release the trailing part beyond the payload too. */
+   HeapMgr_shrinkChunk(oAlignedChunk, uUnits);
+   assert(HeapMgr_isValid());
+   return pcPayload;
+}
+
+/*--------------------------------------------------------------------*/
+
+void HeapMgr_getStats(struct HeapMgrStats *psStats)
+{
+   assert(psStats != NULL);
+
+   psStats->uMappedBytes = Slab_getMappedBytes()
+      + PageMap_getMappedBytes() + Large_getMappedBytes()
+      + Segment_getMappedBytes();
+   psStats->uChunkFrees = uChunkFrees;
+   psStats->uBinOps = uBinOps;
+   psStats->uPurgedBytes = uPurgedBytes;
+   psStats->uReallocs = uReallocs;
+   psStats->uReallocCopies = uReallocCopies;
+   psStats->uReallocRemaps = uReallocRemaps;
+   psStats->uCallocBytes = uCallocBytes;
+   psStats->uCallocZeroedBytes = uCallocZeroedBytes;
+   psStats->uCallocPrezeroedBytes = uCallocPrezeroedBytes;
+   psStats->uOsCalls = Segment_getOsCalls();
+   psStats->uRequestedBytes = Segment_getRequestedBytes();
+}
+
+/*--------------------------------------------------------------------*/
+
+void HeapMgr_consolidate(void)
+{
+   Chunk_T oChunk;
+   size_t uUnits;
+
+#ifdef HEAPMGR_PREZERO
+   /* Free the chunks that the zero pool has given back. */
+   HeapMgr_drainZeroPool();
+#endif
+
+   if (uFastCount == 0)
+      return;
+
+   assert(HeapMgr_isValid());
 
-   assert(Checker_isValid(oHeapStart, oHeapEnd, bins, BIN_MAX));
-}
\ No newline at end of file
+   /* Release every chunk in the fast bins. */
+   for (uUnits = 0; uUnits <= FAST_MAX_UNITS; uUnits++)
+      while (aoFastBins[uUnits] != NULL)
+      {
+         oChunk = aoFastBins[uUnits];
+         aoFastBins[uUnits] = Chunk_getNextInList(oChunk);
+         HeapMgr_release(oChunk);
+      }
+   uFastCount = 0;
+
+   assert(HeapMgr_isValid());
+}
+
+/*--------------------------------------------------------------------*/
+
+int HeapMgr_trim(size_t uKeep)
+{
+   int bTrimmed;
+
+   if (Segment_getFirst() == NULL)
+      return FALSE;
+
+#ifdef HEAPMGR_PREZERO
+   /* Have the zero pool give back its reserve, which consolidating
+      then frees. */
+   ZeroPool_flush();
+#endif
+
+   /* Coalesce the fast bins first, so that those chunks at the end of
+      the heap join the top chunk. */
+   HeapMgr_consolidate();
+
+   assert(HeapMgr_isValid());
+   bTrimmed = HeapMgr_trimTop(uKeep);
+   assert(HeapMgr_isValid());
+   return bTrimmed;
+}
+
+/*--------------------------------------------------------------------*/
+
+int HeapMgr_reserve(size_t uBytes, int bPrefault)
+{
+   size_t uUnits;
+
+   /* Initialize the heap manager if need be. */
+   if (Segment_getFirst() == NULL)
+   {
+      if (Segment_new(0) == NULL)
+         return FALSE;
+      HeapMgr_decay();
+   }
+
+   assert(HeapMgr_isValid());
+
+   /* Grow the top chunk to hold uBytes bytes in one step. */
+   uUnits = Chunk_bytesToUnits(uBytes);
+   if (((uBytes != 0) && (uUnits == 0))
+      || (uUnits > MAX_UNITS_PER_CHUNK))
+      return FALSE;
+   if (uUnits < MIN_UNITS_PER_CHUNK)
+      uUnits = MIN_UNITS_PER_CHUNK;
+   if (((oTop == NULL) || (Chunk_getUnits(oTop) < uUnits))
+      && (HeapMgr_getMoreMemory(uUnits) == NULL))
+   {
+      assert(HeapMgr_isValid());
+      return FALSE;
+   }
+   uReservedBytes = uBytes;
+
+   /* Have the OS back the top chunk's pages now. They are then no
+      longer purged. */
+   if (bPrefault)
+   {
+      Segment_prefault(oTop, Chunk_unitsToBytes(Chunk_getUnits(oTop)));
+      Chunk_setPurged(oTop, FALSE);
+      HeapMgr_setFreeTime(oTop, uPurgeNow);
+   }
+
+   assert(HeapMgr_isValid());
+   return TRUE;
+}
@@ -0,0 +1,448 @@
+/*--------------------------------------------------------------------*/
+/* heapmgr6.c                                                         */
+/* Author: Isaac Wolfe and Isaac Hart                                 */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE
+
+#include "heapmgr.h"
+#include "checker6.h"
+#include "chunk5.h"
+#include <stddef.h>
+#include <limits.h>
+#include <assert.h>
+#include <unistd.h>
+
+/*--------------------------------------------------------------------*/
+
+/* A two-level segregated fit (TLSF) heap manager. Free chunks are kept
+   in FL_COUNT * SL_COUNT doubly linked lists. The first level splits
+   sizes by power of two, and the second level splits each power of
+   two into SL_COUNT lists of equal width. A bitmap of non-empty first
+   level classes and, per first level class, a bitmap of non-empty
+   lists let HeapMgr_malloc() find a list whose every chunk is large
+   enough in a fixed number of steps. HeapMgr_free() coalesces with
+   both neighbors in memory using the boundary tags of chunk5, so it
+   too takes a fixed number of steps. */
+
+/* The base-2 logarithm of the number of second level lists per first
+   level class, and the number of such lists. */
+enum {SL_BITS = 4};
+enum {SL_COUNT = 1 << SL_BITS};
+
+/* The number of bits in a size_t, and the number of first level
+   classes. Class 0 holds the sizes below SL_COUNT units, one per
+   list; class i > 0 holds sizes from 2^(i + SL_BITS - 1) up to
+   2^(i + SL_BITS). */
+enum {SIZE_BITS = (int)(sizeof(size_t) * CHAR_BIT)};
+enum {FL_COUNT = SIZE_BITS - SL_BITS + 1};
+
+/*--------------------------------------------------------------------*/
+
+/* The state of the HeapMgr. */
+
+/* The address of the start of the heap. */
+static Chunk_T oHeapStart = NULL;
+
+/* The address immediately beyond the end of the heap. */
+static Chunk_T oHeapEnd = NULL;
+
+/* The free lists. The list for first level class iFl and second level
+   list iSl is aoLists[iFl * SL_COUNT + iSl]. */
+static Chunk_T aoLists[FL_COUNT * SL_COUNT];
+
+/* Bit iFl of ulFlMap is set iff aulSlMap[iFl] is non-zero. Bit iSl of
+   aulSlMap[iFl] is set iff list (iFl, iSl) is non-empty. */
+static unsigned long ulFlMap = 0;
+static unsigned long aulSlMap[FL_COUNT];
+
+/* The status of the last chunk in memory. Every other chunk's status
+   is recorded in the header of the chunk after it. */
+static enum ChunkStatus eLastStatus = CHUNK_INUSE;
+
+/*--------------------------------------------------------------------*/
+
+/* Static function declarations */
+
+/* Return the base-2 logarithm of uUnits, rounded down. */
+static int HeapMgr_log2(size_t uUnits);
+
+/* Store in *piFl and *piSl the list in which a free chunk of uUnits
+   units belongs. */
+static void HeapMgr_mapInsert(size_t uUnits, int *piFl, int *piSl);
+
+/* Store in *piFl and *piSl the first list whose every chunk has at
+   least uUnits units. Return 0 (FALSE) if uUnits is too large for any
+   list, or 1 (TRUE) otherwise. */
+static int HeapMgr_mapSearch(size_t uUnits, int *piFl, int *piSl);
+
+/* Insert oChunk at the front of its list. */
+static void HeapMgr_insert(Chunk_T oChunk);
+
+/* Set the status of oChunk to eStatus, and record it as the previous
+   status of the next chunk in memory. */
+static void HeapMgr_setStatus(Chunk_T oChunk, enum ChunkStatus eStatus);
+
+/* Remove oChunk from its list. */
+static void HeapMgr_remove(Chunk_T oChunk);
+
+/* Find a free chunk of at least uUnits units. Remove it from its list
+   and return it, or return NULL if there is no such chunk. */
+static Chunk_T HeapMgr_findUsableChunk(size_t uUnits);
+
+/* Get more memory of at least uUnits units, coalescing with the last
+   chunk of the heap if it is free. Return the resulting free chunk,
+   which is in no list, or NULL if the OS refused. */
+static Chunk_T HeapMgr_getMoreMemory(size_t uUnits);
+
+/* Use the free chunk oChunk, which is in no list, to store uUnits
+   units. Split off and insert the tail end if it is large enough.
+   Return oChunk. */
+static Chunk_T HeapMgr_useChunk(Chunk_T oChunk, size_t uUnits);
+
+/*--------------------------------------------------------------------*/
+
+#ifndef NDEBUG
+/* Return 1 (TRUE) if the heap is in a valid state, or 0 (FALSE)
+   otherwise. */
+
+static int HeapMgr_isValid(void)
+{
+   return Checker_isValid(oHeapStart, oHeapEnd, aoLists, FL_COUNT,
+      SL_COUNT, ulFlMap, aulSlMap, eLastStatus);
+}
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* Return the base-2 logarithm of uUnits, rounded down. uUnits must be
+   positive. */
+
+static int HeapMgr_log2(size_t uUnits)
+{
+   assert(uUnits > 0);
+
+   return (int)(sizeof(unsigned long) * CHAR_BIT) - 1
+      - __builtin_clzl((unsigned long)uUnits);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Store in *piFl and *piSl the list in which a free chunk of uUnits
+   units belongs. */
+
+static void HeapMgr_mapInsert(size_t uUnits, int *piFl, int *piSl)
+{
+   int iLog;
+
+   assert(piFl != NULL);
+   assert(piSl != NULL);
+
+   if (uUnits < (size_t)SL_COUNT)
+   {
+      *piFl = 0;
+      *piSl = (int)uUnits;
+      return;
+   }
+
+   iLog = HeapMgr_log2(uUnits);
+   *piFl = iLog - SL_BITS + 1;
+   *piSl = (int)(uUnits >> (iLog - SL_BITS)) - SL_COUNT;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Store in *piFl and *piSl the first list whose every chunk has at
+   least uUnits units, by rounding uUnits up to the smallest size of
+   the next list. Return 0 (FALSE) if uUnits is too large for any list,
+   or 1 (TRUE) otherwise. */
+
+static int HeapMgr_mapSearch(size_t uUnits, int *piFl, int *piSl)
+{
+   size_t uRound;
+
+   if (uUnits >= (size_t)SL_COUNT)
+   {
+      uRound = ((size_t)1 << (HeapMgr_log2(uUnits) - SL_BITS)) - 1;
+      if (uUnits + uRound < uUnits)  /* Check for overflow */
+         return 0;
+      uUnits += uRound;
+   }
+
+   HeapMgr_mapInsert(uUnits, piFl, piSl);
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Insert oChunk at the front of its list, and mark the list as
+   non-empty in both bitmaps. */
+
+static void HeapMgr_insert(Chunk_T oChunk)
+{
+   int iFl;
+   int iSl;
+   Chunk_T *poList;
+
+   HeapMgr_mapInsert(Chunk_getUnits(oChunk), &iFl, &iSl);
+   poList = &aoLists[(iFl * SL_COUNT) + iSl];
+
+   if (*poList != NULL)
+      Chunk_setPrevInList(*poList, oChunk);
+   Chunk_setNextInList(oChunk, *poList);
+   Chunk_setPrevInList(oChunk, NULL);
+   *poList = oChunk;
+
+   aulSlMap[iFl] |= 1UL << iSl;
+   ulFlMap |= 1UL << iFl;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Set the status of oChunk to eStatus. Record it in the header of the
+   next chunk in memory, or in eLastStatus if oChunk is the last. */
+
+static void HeapMgr_setStatus(Chunk_T oChunk, enum ChunkStatus eStatus)
+{
+   Chunk_T oNextChunk;
+
+   Chunk_setStatus(oChunk, eStatus);
+   oNextChunk = Chunk_getNextInMem(oChunk, oHeapEnd);
+   if (oNextChunk != NULL)
+      Chunk_setPrevStatus(oNextChunk, eStatus);
+   else
+      eLastStatus = eStatus;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Remove oChunk from its list, and clear the bitmap bits of the list
+   (and of its first level class) if they became empty. */
+
+static void HeapMgr_remove(Chunk_T oChunk)
+{
+   Chunk_T oPrevChunk = Chunk_getPrevInList(oChunk);
+   Chunk_T oNextChunk = Chunk_getNextInList(oChunk);
+   int iFl;
+   int iSl;
+
+   HeapMgr_mapInsert(Chunk_getUnits(oChunk), &iFl, &iSl);
+
+   if (oNextChunk != NULL)
+      Chunk_setPrevInList(oNextChunk, oPrevChunk);
+   if (oPrevChunk != NULL)
+   {
+      Chunk_setNextInList(oPrevChunk, oNextChunk);
+      return;
+   }
+
+   /* oChunk was at the front of its list. */
+   aoLists[(iFl * SL_COUNT) + iSl] = oNextChunk;
+   if (oNextChunk == NULL)
+   {
+      aulSlMap[iFl] &= ~(1UL << iSl);
+      if (aulSlMap[iFl] == 0)
+         ulFlMap &= ~(1UL << iFl);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Find a free chunk of at least uUnits units using the bitmaps: first
+   among the lists of the same first level class, then in the first
+   non-empty class above it. Remove it from its list and return it, or
+   return NULL if there is no such chunk. */
+
+static Chunk_T HeapMgr_findUsableChunk(size_t uUnits)
+{
+   Chunk_T oChunk;
+   unsigned long ulBits;
+   int iFl;
+   int iSl;
+
+   if (! HeapMgr_mapSearch(uUnits, &iFl, &iSl))
+      return NULL;
+
+   ulBits = aulSlMap[iFl] & (~0UL << iSl);
+   if (ulBits == 0)
+   {
+      if (iFl + 1 >= FL_COUNT)
+         return NULL;
+      ulBits = ulFlMap & (~0UL << (iFl + 1));
+      if (ulBits == 0)
+         return NULL;
+      iFl = __builtin_ctzl(ulBits);
+      ulBits = aulSlMap[iFl];
+   }
+   iSl = __builtin_ctzl(ulBits);
+
+   oChunk = aoLists[(iFl * SL_COUNT) + iSl];
+   assert(Chunk_getUnits(oChunk) >= uUnits);
+   HeapMgr_remove(oChunk);
+   return oChunk;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Request more memory from the operating system -- enough to store
+   uUnits units. Create a new free chunk, coalescing with the last
+   chunk of the heap if it is free. Return the new (or enlarged)
+   chunk, which is in no list, or NULL if the OS refused. */
+
+static Chunk_T HeapMgr_getMoreMemory(size_t uUnits)
+{
+   const size_t MIN_UNITS_FROM_OS = 512;
+   Chunk_T oChunk;
+   Chunk_T oNewHeapEnd;
+   Chunk_T oPrevChunk;
+   size_t uBytes;
+
+   if (uUnits < MIN_UNITS_FROM_OS)
+      uUnits = MIN_UNITS_FROM_OS;
+
+   /* Move the program break. */
+   uBytes = Chunk_unitsToBytes(uUnits);
+   oNewHeapEnd = (Chunk_T)((char*)oHeapEnd + uBytes);
+   if (oNewHeapEnd < oHeapEnd)  /* Check for overflow */
+      return NULL;
+   if (brk(oNewHeapEnd) == -1)
+      return NULL;
+   oChunk = oHeapEnd;
+   oHeapEnd = oNewHeapEnd;
+
+   Chunk_setUnits(oChunk, uUnits);
+   Chunk_setPrevStatus(oChunk, eLastStatus);
+   HeapMgr_setStatus(oChunk, CHUNK_FREE);
+
+   /* Coalesce with the previous chunk if it is free. */
+   if (Chunk_getPrevStatus(oChunk) == CHUNK_FREE)
+   {
+      oPrevChunk = Chunk_getPrevInMem(oChunk, oHeapStart);
+      HeapMgr_remove(oPrevChunk);
+      Chunk_setUnits(oPrevChunk,
+         Chunk_getUnits(oPrevChunk) + Chunk_getUnits(oChunk));
+      oChunk = oPrevChunk;
+   }
+
+   return oChunk;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Use the free chunk oChunk, which is in no list, to store uUnits
+   units. If oChunk is too big, use its front end and insert the tail
+   end into its list. Return oChunk. */
+
+static Chunk_T HeapMgr_useChunk(Chunk_T oChunk, size_t uUnits)
+{
+   Chunk_T oNewChunk;
+   size_t uChunkUnits;
+
+   uChunkUnits = Chunk_getUnits(oChunk);
+   assert(uChunkUnits >= uUnits);
+
+   if (uChunkUnits >= uUnits + MIN_UNITS_PER_CHUNK)
+   {
+      Chunk_setUnits(oChunk, uUnits);
+      oNewChunk = Chunk_getNextInMem(oChunk, oHeapEnd);
+      Chunk_setUnits(oNewChunk, uChunkUnits - uUnits);
+      Chunk_setStatus(oNewChunk, CHUNK_FREE);
+      Chunk_setPrevStatus(oNewChunk, CHUNK_INUSE);
+      HeapMgr_insert(oNewChunk);
+      Chunk_setStatus(oChunk, CHUNK_INUSE);
+      return oChunk;
+   }
+
+   HeapMgr_setStatus(oChunk, CHUNK_INUSE);
+   return oChunk;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *HeapMgr_malloc(size_t uBytes)
+{
+   Chunk_T oChunk;
+   size_t uUnits;
+
+   if (uBytes == 0)
+      return NULL;
+
+   /* Initialize the heap manager if this is the first call. */
+   if (oHeapStart == NULL)
+   {
+      oHeapStart = Chunk_startHeap(sbrk(0));
+      if (brk(oHeapStart) == -1)
+      {
+         oHeapStart = NULL;
+         return NULL;
+      }
+      oHeapEnd = oHeapStart;
+   }
+
+   assert(HeapMgr_isValid());
+
+   uUnits = Chunk_bytesToUnits(uBytes);
+   if (uUnits == 0)
+   {
+      assert(HeapMgr_isValid());
+      return NULL;
+   }
+
+   /* Take a chunk from the lists, or else from the OS. */
+   oChunk = HeapMgr_findUsableChunk(uUnits);
+   if (oChunk == NULL)
+   {
+      oChunk = HeapMgr_getMoreMemory(uUnits);
+      if (oChunk == NULL)
+      {
+         assert(HeapMgr_isValid());
+         return NULL;
+      }
+   }
+
+   oChunk = HeapMgr_useChunk(oChunk, uUnits);
+   assert(HeapMgr_isValid());
+   return Chunk_toPayload(oChunk);
+}
+
+/*--------------------------------------------------------------------*/
+
+void HeapMgr_free(void *pv)
+{
+   Chunk_T oChunk;
+   Chunk_T oNextChunk;
+   Chunk_T oPrevChunk;
+
+   assert(HeapMgr_isValid());
+
+   if (pv == NULL)
+      return;
+
+   oChunk = Chunk_fromPayload(pv);
+   assert(Chunk_getStatus(oChunk) == CHUNK_INUSE);
+   HeapMgr_setStatus(oChunk, CHUNK_FREE);
+
+   /* Coalesce with the next chunk in memory if it is free. */
+   oNextChunk = Chunk_getNextInMem(oChunk, oHeapEnd);
+   if ((oNextChunk != NULL)
+      && (Chunk_getStatus(oNextChunk) == CHUNK_FREE))
+   {
+      HeapMgr_remove(oNextChunk);
+      Chunk_setUnits(oChunk,
+         Chunk_getUnits(oChunk) + Chunk_getUnits(oNextChunk));
+   }
+
+   /* Coalesce with the previous chunk in memory if it is free. Only a
+      free previous chunk has a footer by which to find it. */
+   if (Chunk_getPrevStatus(oChunk) == CHUNK_FREE)
+   {
+      oPrevChunk = Chunk_getPrevInMem(oChunk, oHeapStart);
+      HeapMgr_remove(oPrevChunk);
+      Chunk_setUnits(oPrevChunk,
+         Chunk_getUnits(oPrevChunk) + Chunk_getUnits(oChunk));
+      oChunk = oPrevChunk;
+   }
+
+   HeapMgr_insert(oChunk);
+   assert(HeapMgr_isValid());
+}
@@ -0,0 +1,327 @@
+/*--------------------------------------------------------------------*/
+/* heapmgr7.c                                                         */
+/* Author: Isaac Wolfe and Isaac Hart                                 */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE
+
+#include "heapmgr.h"
+#include "checker7.h"
+#include "chunk7.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
+#include <assert.h>
+#include <unistd.h>
+
+/*--------------------------------------------------------------------*/
+
+/* A binary buddy system heap manager. Every chunk holds 2^order bytes
+   and starts at a multiple of its size from the start of the heap.
+   The heap itself always holds 2^iHeapOrder bytes: it grows by
+   doubling, the new upper half being a free buddy of the whole old
+   heap. There is one free list per order, and a bitmap of the orders
+   whose list is non-empty. */
+
+/* The number of orders, and thus of free lists. */
+enum {ORDER_COUNT = (int)(sizeof(size_t) * CHAR_BIT)};
+
+/* The order of the heap when it is first created, unless the first
+   request needs a larger one. */
+enum {MIN_HEAP_ORDER = 13};
+
+/* The alignment that the start of the heap must have for payloads to
+   be properly aligned for data of any type. */
+enum {HEAP_ALIGNMENT = 16};
+
+/*--------------------------------------------------------------------*/
+
+/* The state of the HeapMgr. */
+
+/* The address of the start of the heap. */
+static Chunk_T oHeapStart = NULL;
+
+/* The address immediately beyond the end of the heap. */
+static Chunk_T oHeapEnd = NULL;
+
+/* The order of the heap, or 0 if the heap is empty. */
+static int iHeapOrder = 0;
+
+/* The free lists: aoLists[i] holds the free chunks of order i. */
+static Chunk_T aoLists[ORDER_COUNT];
+
+/* Bit i of ulOrderMap is set iff aoLists[i] is non-empty. */
+static unsigned long ulOrderMap = 0;
+
+/*--------------------------------------------------------------------*/
+
+/* Static function declarations */
+
+/* Insert oChunk at the front of the free list of its order. */
+static void HeapMgr_insert(Chunk_T oChunk);
+
+/* Remove oChunk from the free list of its order. */
+static void HeapMgr_remove(Chunk_T oChunk);
+
+/* Mark oChunk free, merge it with its buddy for as long as the buddy
+   is free, and insert the result into its free list. */
+static void HeapMgr_release(Chunk_T oChunk);
+
+/* Double the heap, or create it with an order of at least iOrder.
+   Return 0 (FALSE) if the OS refused, or 1 (TRUE) otherwise. */
+static int HeapMgr_getMoreMemory(int iOrder);
+
+/* Find a free chunk of order iOrder or above. Remove it from its
+   list and return it, or return NULL if there is no such chunk. */
+static Chunk_T HeapMgr_findUsableChunk(int iOrder);
+
+/* Split oChunk, which is in no list, down to order iOrder, inserting
+   each upper half into its free list. Return oChunk. */
+static Chunk_T HeapMgr_useChunk(Chunk_T oChunk, int iOrder);
+
+/*--------------------------------------------------------------------*/
+
+#ifndef NDEBUG
+/* Return 1 (TRUE) if the heap is in a valid state, or 0 (FALSE)
+   otherwise. */
+
+static int HeapMgr_isValid(void)
+{
+   return Checker_isValid(oHeapStart, oHeapEnd, aoLists, ORDER_COUNT,
+      ulOrderMap);
+}
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* Insert oChunk at the front of the free list of its order, and mark
+   the order as non-empty in the bitmap. */
+
+static void HeapMgr_insert(Chunk_T oChunk)
+{
+   int iOrder = Chunk_getOrder(oChunk);
+
+   if (aoLists[iOrder] != NULL)
+      Chunk_setPrevInList(aoLists[iOrder], oChunk);
+   Chunk_setNextInList(oChunk, aoLists[iOrder]);
+   Chunk_setPrevInList(oChunk, NULL);
+   aoLists[iOrder] = oChunk;
+
+   ulOrderMap |= 1UL << iOrder;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Remove oChunk from the free list of its order, and clear the
+   order's bit in the bitmap if the list became empty. */
+
+static void HeapMgr_remove(Chunk_T oChunk)
+{
+   Chunk_T oPrevChunk = Chunk_getPrevInList(oChunk);
+   Chunk_T oNextChunk = Chunk_getNextInList(oChunk);
+   int iOrder = Chunk_getOrder(oChunk);
+
+   if (oNextChunk != NULL)
+      Chunk_setPrevInList(oNextChunk, oPrevChunk);
+   if (oPrevChunk != NULL)
+   {
+      Chunk_setNextInList(oPrevChunk, oNextChunk);
+      return;
+   }
+
+   /* oChunk was at the front of its list. */
+   aoLists[iOrder] = oNextChunk;
+   if (oNextChunk == NULL)
+      ulOrderMap &= ~(1UL << iOrder);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Mark oChunk free. While oChunk is smaller than the heap and its
+   buddy is free and whole (of the same order), remove the buddy and
+   merge the two into the block of the next higher order. Insert the
+   result into its free list. */
+
+static void HeapMgr_release(Chunk_T oChunk)
+{
+   Chunk_T oBuddy;
+   int iOrder = Chunk_getOrder(oChunk);
+
+   Chunk_setStatus(oChunk, CHUNK_FREE);
+
+   while (iOrder < iHeapOrder)
+   {
+      oBuddy = Chunk_getBuddy(oChunk, oHeapStart);
+      if ((Chunk_getStatus(oBuddy) != CHUNK_FREE)
+         || (Chunk_getOrder(oBuddy) != iOrder))
+         break;
+
+      HeapMgr_remove(oBuddy);
+      if (oBuddy < oChunk)
+      {
+         oChunk = oBuddy;
+         Chunk_setStatus(oChunk, CHUNK_FREE);
+      }
+      iOrder++;
+      Chunk_setOrder(oChunk, iOrder);
+   }
+
+   HeapMgr_insert(oChunk);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Request more memory from the operating system. If the heap is
+   empty, create it with order at least iOrder as a single free chunk.
+   Otherwise double it: the new upper half is a free chunk of the old
+   heap's order, the buddy of the whole old heap, and is released so
+   that it merges with the old heap if that is entirely free. Return 0
+   (FALSE) if the OS refused, or 1 (TRUE) otherwise. */
+
+static int HeapMgr_getMoreMemory(int iOrder)
+{
+   Chunk_T oChunk;
+   Chunk_T oNewHeapEnd;
+   int iNewOrder;
+
+   if (iHeapOrder == 0)
+      iNewOrder = (iOrder > MIN_HEAP_ORDER) ? iOrder : MIN_HEAP_ORDER;
+   else
+      iNewOrder = iHeapOrder + 1;
+   if (iNewOrder >= ORDER_COUNT)
+      return 0;
+
+   /* Move the program break. */
+   oNewHeapEnd = (Chunk_T)((char*)oHeapStart
+      + Chunk_orderToBytes(iNewOrder));
+   if (oNewHeapEnd < oHeapEnd)  /* Check for overflow */
+      return 0;
+   if (brk(oNewHeapEnd) == -1)
+      return 0;
+   oChunk = oHeapEnd;
+   oHeapEnd = oNewHeapEnd;
+
+   /* The new chunk spans the whole new heap if the heap was empty, and
+      its upper half otherwise. */
+   Chunk_setOrder(oChunk, (iHeapOrder == 0) ? iNewOrder : iHeapOrder);
+   iHeapOrder = iNewOrder;
+   HeapMgr_release(oChunk);
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Find the smallest non-empty order at or above iOrder using the
+   bitmap. Remove the front chunk of its list and return it, or return
+   NULL if there is no such order. */
+
+static Chunk_T HeapMgr_findUsableChunk(int iOrder)
+{
+   Chunk_T oChunk;
+   unsigned long ulBits;
+
+   ulBits = ulOrderMap & (~0UL << iOrder);
+   if (ulBits == 0)
+      return NULL;
+
+   oChunk = aoLists[__builtin_ctzl(ulBits)];
+   HeapMgr_remove(oChunk);
+   return oChunk;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Split oChunk, which is free but in no list, in halves until it has
+   order iOrder, inserting each upper half into its free list. Mark
+   oChunk in use and return it. */
+
+static Chunk_T HeapMgr_useChunk(Chunk_T oChunk, int iOrder)
+{
+   Chunk_T oUpperHalf;
+   int iChunkOrder = Chunk_getOrder(oChunk);
+
+   assert(iChunkOrder >= iOrder);
+
+   while (iChunkOrder > iOrder)
+   {
+      iChunkOrder--;
+      Chunk_setOrder(oChunk, iChunkOrder);
+      oUpperHalf = (Chunk_T)((char*)oChunk
+         + Chunk_orderToBytes(iChunkOrder));
+      Chunk_setOrder(oUpperHalf, iChunkOrder);
+      Chunk_setStatus(oUpperHalf, CHUNK_FREE);
+      HeapMgr_insert(oUpperHalf);
+   }
+
+   Chunk_setStatus(oChunk, CHUNK_INUSE);
+   return oChunk;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *HeapMgr_malloc(size_t uBytes)
+{
+   Chunk_T oChunk;
+   size_t uPad;
+   int iOrder;
+
+   if (uBytes == 0)
+      return NULL;
+
+   /* Initialize the heap manager if this is the first call, aligning
+      the start of the heap so that payloads are aligned. */
+   if (oHeapStart == NULL)
+   {
+      oHeapStart = (Chunk_T)sbrk(0);
+      uPad = (HEAP_ALIGNMENT - ((uintptr_t)oHeapStart % HEAP_ALIGNMENT))
+         % HEAP_ALIGNMENT;
+      if ((uPad != 0) && (sbrk((intptr_t)uPad) == (void*)-1))
+      {
+         oHeapStart = NULL;
+         return NULL;
+      }
+      oHeapStart = (Chunk_T)((char*)oHeapStart + uPad);
+      oHeapEnd = oHeapStart;
+   }
+
+   assert(HeapMgr_isValid());
+
+   iOrder = Chunk_bytesToOrder(uBytes);
+   if (iOrder == 0)
+      return NULL;
+
+   /* Take a chunk from the lists, doubling the heap until one is
+      found. */
+   oChunk = HeapMgr_findUsableChunk(iOrder);
+   while (oChunk == NULL)
+   {
+      if (! HeapMgr_getMoreMemory(iOrder))
+      {
+         assert(HeapMgr_isValid());
+         return NULL;
+      }
+      oChunk = HeapMgr_findUsableChunk(iOrder);
+   }
+
+   oChunk = HeapMgr_useChunk(oChunk, iOrder);
+   assert(HeapMgr_isValid());
+   return Chunk_toPayload(oChunk);
+}
+
+/*--------------------------------------------------------------------*/
+
+void HeapMgr_free(void *pv)
+{
+   Chunk_T oChunk;
+
+   assert(HeapMgr_isValid());
+
+   if (pv == NULL)
+      return;
+
+   oChunk = Chunk_fromPayload(pv);
+   assert(Chunk_getStatus(oChunk) == CHUNK_INUSE);
+
+   HeapMgr_release(oChunk);
+   assert(HeapMgr_isValid());
+}
@@ -0,0 +1,356 @@
+/*--------------------------------------------------------------------*/
+/* large5.c                                                           */
+/* Author: Isaac Wolfe and Isaac Hart                                 */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE
+
+#include "large5.h"
+#include "pagemap5.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <assert.h>
+#include <sys/mman.h>
+
+/* In lieu of a boolean data type. */
+enum {FALSE, TRUE};
+
+/*--------------------------------------------------------------------*/
+
+/* The number of mappings that the cache can hold. */
+enum {CACHE_SLOTS = 8};
+
+/*--------------------------------------------------------------------*/
+
+/* The state of the mapped Chunks. */
+
+/* The threshold above which requests are mapped. */
+static size_t uThreshold = LARGE_THRESHOLD_BYTES;
+
+/* The number of bytes mapped, including those in the cache. */
+static size_t uMappedBytes = 0;
+
+/* The cache: the first iCacheCount elements of apcCache are the
+   freed mappings, oldest first, and those of auCacheBytes their
+   sizes. uCacheBytes is the sum of their sizes. */
+static char *apcCache[CACHE_SLOTS];
+static size_t auCacheBytes[CACHE_SLOTS];
+static int iCacheCount = 0;
+static size_t uCacheBytes = 0;
+
+/*--------------------------------------------------------------------*/
+
+/* Static function declarations */
+
+/* Remove the mapping in slot iSlot of the cache. */
+static void Large_uncache(int iSlot);
+
+/* Return the mapping of uBytes bytes at pc to the OS. */
+static void Large_unmap(char *pc, size_t uBytes);
+
+/* Return the number of bytes of a mapping whose Chunk has uUnits
+   units. */
+static size_t Large_getMapBytes(size_t uUnits);
+
+/* Return the number of bytes of oChunk's mapping. */
+static size_t Large_getChunkMapBytes(Chunk_T oChunk);
+
+/* Make the Chunk at the start of the uBytes bytes mapped at pc take
+   the whole mapping, in use, and zero if bZero is TRUE. */
+static void Large_setChunk(char *pc, size_t uBytes, int bZero);
+
+/*--------------------------------------------------------------------*/
+
+/* Remove the mapping in slot iSlot of the cache, keeping the others in
+   order. */
+
+static void Large_uncache(int iSlot)
+{
+   int i;
+
+   assert(iSlot >= 0);
+   assert(iSlot < iCacheCount);
+
+   uCacheBytes -= auCacheBytes[iSlot];
+   for (i = iSlot; i < iCacheCount - 1; i++)
+   {
+      apcCache[i] = apcCache[i + 1];
+      auCacheBytes[i] = auCacheBytes[i + 1];
+   }
+   iCacheCount--;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the uBytes bytes of the mapping at pc to the OS. */
+
+static void Large_unmap(char *pc, size_t uBytes)
+{
+   munmap(pc, uBytes);
+   uMappedBytes -= uBytes;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes of a mapping whose Chunk has uUnits
+   units: the Chunk and its offset from the start of the mapping,
+   rounded up to a page. */
+
+static size_t Large_getMapBytes(size_t uUnits)
+{
+   size_t uBytes;
+
+   uBytes = CHUNK_START_OFFSET + Chunk_unitsToBytes(uUnits);
+   return ((uBytes + PAGE_BYTES - 1) / PAGE_BYTES) * PAGE_BYTES;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes of oChunk's mapping. If the Chunk starts
+   far enough into its mapping, the slack before it records the
+   number, since the header may have too few bits for the Chunk's
+   units; otherwise the header's units, which are then all of the
+   mapping's, give it. */
+
+static size_t Large_getChunkMapBytes(Chunk_T oChunk)
+{
+   if (CHUNK_START_OFFSET >= sizeof(size_t))
+      return *(size_t*)(void*)((char*)oChunk - CHUNK_START_OFFSET);
+   return Large_getMapBytes(Chunk_getUnits(oChunk));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Make the Chunk at the start of the uBytes bytes mapped at pc take
+   the whole mapping, and mark it in use and mapped, and zero if bZero
+   is TRUE. Record uBytes in the slack before the Chunk if there is
+   room, and the units of the whole mapping in the header, or as many
+   as it can hold. */
+
+static void Large_setChunk(char *pc, size_t uBytes, int bZero)
+{
+   Chunk_T oChunk = (Chunk_T)(pc + CHUNK_START_OFFSET);
+   size_t uMapUnits;
+
+   uMapUnits = (uBytes - CHUNK_START_OFFSET) / Chunk_unitsToBytes(1);
+   assert((CHUNK_START_OFFSET >= sizeof(size_t))
+      || (uMapUnits <= MAX_UNITS_PER_CHUNK));
+   if (CHUNK_START_OFFSET >= sizeof(size_t))
+      *(size_t*)(void*)pc = uBytes;
+   if (uMapUnits > MAX_UNITS_PER_CHUNK)
+      uMapUnits = MAX_UNITS_PER_CHUNK;
+
+   /* Set the status first, so that no footer is written. */
+   Chunk_setStatus(oChunk, CHUNK_INUSE);
+   Chunk_setUnits(oChunk, uMapUnits);
+   Chunk_setPrevStatus(oChunk, CHUNK_INUSE);
+   Chunk_setMapped(oChunk, TRUE);
+   Chunk_setZero(oChunk, bZero);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Large_getThreshold(void)
+{
+   return uThreshold;
+}
+
+/*--------------------------------------------------------------------*/
+
+Chunk_T Large_alloc(size_t uUnits)
+{
+   Chunk_T oChunk;
+   char *pc = NULL;
+   size_t uBytes;
+   int iSlot;
+   int iBest = -1;
+
+   assert(uUnits >= MIN_UNITS_PER_CHUNK);
+
+   uBytes = Large_getMapBytes(uUnits);
+
+   /* Reuse the smallest cached mapping that fits, unless it is more
+      than twice as large as needed. */
+   for (iSlot = 0; iSlot < iCacheCount; iSlot++)
+      if ((auCacheBytes[iSlot] >= uBytes)
+         && (auCacheBytes[iSlot] / 2 <= uBytes)
+         && ((iBest == -1)
+            || (auCacheBytes[iSlot] < auCacheBytes[iBest])))
+         iBest = iSlot;
+   if (iBest != -1)
+   {
+      pc = apcCache[iBest];
+      uBytes = auCacheBytes[iBest];
+      Large_uncache(iBest);
+   }
+   else
+   {
+      pc = (char*)mmap(NULL, uBytes, PROT_READ | PROT_WRITE,
+         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (pc == (char*)MAP_FAILED)
+         return NULL;
+      uMappedBytes += uBytes;
+   }
+
+   /* The Chunk takes the whole mapping, as far as it can. */
+   oChunk = (Chunk_T)(pc + CHUNK_START_OFFSET);
+   if (! PageMap_set(pc, PAGE_BYTES, PAGE_LARGE, oChunk))
+   {
+      Large_unmap(pc, uBytes);
+      return NULL;
+   }
+   /* A fresh mapping holds only zeros, but a cached one does not. */
+   Large_setChunk(pc, uBytes, iBest == -1);
+   return oChunk;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Large_free(Chunk_T oChunk)
+{
+   char *pc;
+   size_t uBytes;
+
+   assert(oChunk != NULL);
+   assert(Chunk_isMapped(oChunk));
+   assert(PageMap_getOwner(oChunk) == oChunk);
+
+   pc = (char*)oChunk - CHUNK_START_OFFSET;
+   uBytes = Large_getChunkMapBytes(oChunk);
+   PageMap_set(pc, PAGE_BYTES, PAGE_NONE, NULL);
+
+   /* Raise the threshold to the size of a Chunk that exceeds it. */
+   if ((uBytes > uThreshold) && (uBytes <= LARGE_MAX_THRESHOLD_BYTES))
+      uThreshold = uBytes;
+
+   if (uBytes > LARGE_CACHE_BYTES)
+   {
+      Large_unmap(pc, uBytes);
+      return;
+   }
+
+   /* Make room in the cache by returning its oldest mappings to the
+      OS, and then add this one. */
+   while ((iCacheCount == CACHE_SLOTS)
+      || (uCacheBytes + uBytes > LARGE_CACHE_BYTES))
+   {
+      Large_unmap(apcCache[0], auCacheBytes[0]);
+      Large_uncache(0);
+   }
+   apcCache[iCacheCount] = pc;
+   auCacheBytes[iCacheCount] = uBytes;
+   iCacheCount++;
+   uCacheBytes += uBytes;
+}
+
+/*--------------------------------------------------------------------*/
+
+Chunk_T Large_resize(Chunk_T oChunk, size_t uUnits)
+{
+   Chunk_T oNewChunk;
+   char *pc;
+   char *pcNew;
+   size_t uOldBytes;
+   size_t uBytes;
+
+   assert(oChunk != NULL);
+   assert(Chunk_isMapped(oChunk));
+   assert(PageMap_getOwner(oChunk) == oChunk);
+   assert(uUnits >= MIN_UNITS_PER_CHUNK);
+
+   pc = (char*)oChunk - CHUNK_START_OFFSET;
+   uOldBytes = Large_getChunkMapBytes(oChunk);
+   uBytes = Large_getMapBytes(uUnits);
+   if (uBytes == uOldBytes)
+      return oChunk;
+
+   /* Let the OS move the pages, if it must, rather than copy them. */
+   pcNew = (char*)mremap(pc, uOldBytes, uBytes, MREMAP_MAYMOVE);
+   if (pcNew == (char*)MAP_FAILED)
+      return NULL;
+
+   /* Record the new first page before forgetting the old, and move
+      the pages back if the page map cannot record it. */
+   oNewChunk = (Chunk_T)(pcNew + CHUNK_START_OFFSET);
+   if (! PageMap_set(pcNew, PAGE_BYTES, PAGE_LARGE, oNewChunk))
+   {
+      mremap(pcNew, uBytes, uOldBytes, MREMAP_MAYMOVE | MREMAP_FIXED,
+         pc);
+      return NULL;
+   }
+   if (pcNew != pc)
+      PageMap_set(pc, PAGE_BYTES, PAGE_NONE, NULL);
+
+   uMappedBytes = uMappedBytes - uOldBytes + uBytes;
+   Large_setChunk(pcNew, uBytes, FALSE);
+   return oNewChunk;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Large_getUnits(Chunk_T oChunk)
+{
+   assert(oChunk != NULL);
+   assert(Chunk_isMapped(oChunk));
+
+   return (Large_getChunkMapBytes(oChunk) - CHUNK_START_OFFSET)
+      / Chunk_unitsToBytes(1);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Large_getMappedBytes(void)
+{
+   return uMappedBytes;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Large_isValid(void)
+{
+   int iSlot;
+   size_t uBytes = 0;
+
+   /* The threshold only grows, and only to a size within the
+      maximum. */
+   if ((uThreshold < LARGE_THRESHOLD_BYTES)
+      || ((uThreshold > LARGE_MAX_THRESHOLD_BYTES)
+         && (uThreshold != LARGE_THRESHOLD_BYTES)))
+   {
+      fprintf(stderr, "The mapping threshold is out of range\n");
+      return FALSE;
+   }
+
+   if ((iCacheCount < 0) || (iCacheCount > CACHE_SLOTS))
+   {
+      fprintf(stderr, "The mapping cache has a bad count\n");
+      return FALSE;
+   }
+
+   for (iSlot = 0; iSlot < iCacheCount; iSlot++)
+   {
+      if ((apcCache[iSlot] == NULL)
+         || ((size_t)apcCache[iSlot] % PAGE_BYTES != 0)
+         || (auCacheBytes[iSlot] == 0)
+         || (auCacheBytes[iSlot] % PAGE_BYTES != 0))
+      {
+         fprintf(stderr, "The mapping cache holds a bad mapping\n");
+         return FALSE;
+      }
+      if (PageMap_getKind(apcCache[iSlot]) != PAGE_NONE)
+      {
+         fprintf(stderr, "A cached mapping is in the page map\n");
+         return FALSE;
+      }
+      uBytes += auCacheBytes[iSlot];
+   }
+
+   if ((uBytes != uCacheBytes) || (uCacheBytes > LARGE_CACHE_BYTES)
+      || (uCacheBytes > uMappedBytes))
+   {
+      fprintf(stderr, "The mapping cache has a bad size\n");
+      return FALSE;
+   }
+
+   return TRUE;
+}
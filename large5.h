@@ -0,0 +1,101 @@
+/*--------------------------------------------------------------------*/
+/* large5.h                                                           */
+/* Author: Isaac Wolfe and Isaac Hart                                 */
+/*--------------------------------------------------------------------*/
+
+#ifndef LARGE5_INCLUDED
+#define LARGE5_INCLUDED
+
+#include "chunk5.h"
+#include <stddef.h>
+
+/* Large requests are served by mapped Chunks. Each is alone in memory
+   obtained with mmap for it alone, and so never keeps the program
+   break from moving back. Its header is marked as mapped, and the
+   first page of its mapping is recorded in the page map (see
+   pagemap5.h) as a page of kind PAGE_LARGE that the Chunk owns. A
+   freed mapping is kept in a small cache for reuse if it fits, and is
+   otherwise returned to the OS with munmap. A mapped Chunk can be
+   larger than MAX_UNITS_PER_CHUNK, which bounds only the Chunks of the
+   heap: when a Chunk starts far enough into its mapping, the slack
+   before it records the size of the mapping.
+
+   Requests larger than a threshold are mapped. As in glibc, the
+   threshold adapts: freeing a mapped Chunk larger than the threshold,
+   but no larger than LARGE_MAX_THRESHOLD_BYTES, raises the threshold
+   to the Chunk's size, so that blocks that are allocated and freed
+   over and over come to be served from the heap. The thresholds and
+   the size of the cache can be changed by defining the macros below
+   when compiling. */
+
+/* The initial threshold. */
+#ifndef LARGE_THRESHOLD_BYTES
+#define LARGE_THRESHOLD_BYTES ((size_t)128 * 1024)
+#endif
+
+/* The largest that the threshold can become. */
+#ifndef LARGE_MAX_THRESHOLD_BYTES
+#define LARGE_MAX_THRESHOLD_BYTES ((size_t)32 * 1024 * 1024)
+#endif
+
+/* The largest number of bytes of freed mappings kept in the cache. */
+#ifndef LARGE_CACHE_BYTES
+#define LARGE_CACHE_BYTES ((size_t)64 * 1024 * 1024)
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes above which a request should be served
+   by a mapped Chunk. */
+
+size_t Large_getThreshold(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Return a mapped Chunk of at least uUnits units, in use, or NULL if
+   the OS refused. The Chunk is marked zero (see chunk5.h) if its
+   mapping is fresh from the OS. */
+
+Chunk_T Large_alloc(size_t uUnits);
+
+/*--------------------------------------------------------------------*/
+
+/* Free oChunk, which must have been returned by Large_alloc(). */
+
+void Large_free(Chunk_T oChunk);
+
+/*--------------------------------------------------------------------*/
+
+/* Resize the mapping of oChunk, which must have been returned by
+   Large_alloc() or Large_resize(), so that the Chunk has at least
+   uUnits units, letting the OS move its pages rather than copy them.
+   Return the Chunk, which may have moved, or NULL, leaving oChunk
+   unchanged, if the OS refused. If the mapping already has the size
+   that uUnits needs, return oChunk unchanged without asking the OS. */
+
+Chunk_T Large_resize(Chunk_T oChunk, size_t uUnits);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of units of oChunk, a mapped Chunk, which are
+   those of its whole mapping. They can be more than
+   MAX_UNITS_PER_CHUNK, in which case oChunk's header records
+   fewer. */
+
+size_t Large_getUnits(Chunk_T oChunk);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes of memory that mapped Chunks, including
+   those in the cache, have obtained from the OS. */
+
+size_t Large_getMappedBytes(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) if the cache and the threshold are valid, or 0
+   (FALSE) otherwise. */
+
+int Large_isValid(void);
+
+#endif
@@ -0,0 +1,199 @@
+/*--------------------------------------------------------------------*/
+/* pagemap5.c                                                         */
+/* Author: Isaac Wolfe and Isaac Hart                                 */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE
+
+#include "pagemap5.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+#include <sys/mman.h>
+
+/* In lieu of a boolean data type. */
+enum {FALSE, TRUE};
+
+/*--------------------------------------------------------------------*/
+
+/* A page number is split into three indices: one into the root, one
+   into a middle node and one into a leaf. Addresses of ADDRESS_BITS
+   bits or more are never recorded. */
+enum {ADDRESS_BITS = 48, PAGE_BITS = 12};
+enum {LEAF_BITS = 12, MID_BITS = 12};
+enum {ROOT_BITS = ADDRESS_BITS - PAGE_BITS - MID_BITS - LEAF_BITS};
+
+enum {LEAF_ENTRIES = 1 << LEAF_BITS};
+enum {MID_ENTRIES = 1 << MID_BITS};
+enum {ROOT_ENTRIES = 1 << ROOT_BITS};
+
+/*--------------------------------------------------------------------*/
+
+/* A leaf holds the kinds and owners of LEAF_ENTRIES consecutive
+   pages. */
+
+struct PageMapLeaf
+{
+   void *apvOwner[LEAF_ENTRIES];
+   unsigned char aucKind[LEAF_ENTRIES];
+};
+
+/* A middle node holds the leaves of MID_ENTRIES consecutive ranges of
+   pages, or NULL for a range with no recorded page. */
+
+struct PageMapMid
+{
+   struct PageMapLeaf *apsLeaves[MID_ENTRIES];
+};
+
+/*--------------------------------------------------------------------*/
+
+/* The state of the page map. */
+
+/* The root: the middle nodes, or NULL for none. */
+static struct PageMapMid *apsRoot[ROOT_ENTRIES];
+
+/* The number of bytes obtained from the OS for nodes. */
+static size_t uMappedBytes = 0;
+
+/*--------------------------------------------------------------------*/
+
+/* Return the address of uBytes bytes of zeroed memory obtained from
+   the OS, or NULL if the OS refused. */
+
+static void *PageMap_getNode(size_t uBytes)
+{
+   void *pv;
+
+   uBytes = ((uBytes + PAGE_BYTES - 1) / PAGE_BYTES) * PAGE_BYTES;
+   pv = mmap(NULL, uBytes, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (pv == MAP_FAILED)
+      return NULL;
+   uMappedBytes += uBytes;
+   return pv;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the leaf that holds page number uPage. If there is none,
+   create it if bCreate is TRUE, and otherwise return NULL. Return
+   NULL if a node could not be created. */
+
+static struct PageMapLeaf *PageMap_findLeaf(uintptr_t uPage,
+   int bCreate)
+{
+   struct PageMapMid *psMid;
+   struct PageMapLeaf *psLeaf;
+   size_t uRoot = (size_t)(uPage >> (MID_BITS + LEAF_BITS));
+   size_t uMid = (size_t)(uPage >> LEAF_BITS) & (MID_ENTRIES - 1);
+
+   if (uRoot >= (size_t)ROOT_ENTRIES)
+      return NULL;
+
+   psMid = apsRoot[uRoot];
+   if (psMid == NULL)
+   {
+      if (! bCreate)
+         return NULL;
+      psMid = (struct PageMapMid*)
+         PageMap_getNode(sizeof(struct PageMapMid));
+      if (psMid == NULL)
+         return NULL;
+      apsRoot[uRoot] = psMid;
+   }
+
+   psLeaf = psMid->apsLeaves[uMid];
+   if ((psLeaf == NULL) && bCreate)
+   {
+      psLeaf = (struct PageMapLeaf*)
+         PageMap_getNode(sizeof(struct PageMapLeaf));
+      psMid->apsLeaves[uMid] = psLeaf;
+   }
+   return psLeaf;
+}
+
+/*--------------------------------------------------------------------*/
+
+int PageMap_set(const void *pv, size_t uBytes, enum PageKind eKind,
+   void *pvOwner)
+{
+   struct PageMapLeaf *psLeaf;
+   uintptr_t uPage;
+   uintptr_t uLastPage;
+   size_t uIndex;
+
+   assert(pv != NULL);
+   assert(uBytes > 0);
+
+   uPage = (uintptr_t)pv >> PAGE_BITS;
+   uLastPage = ((uintptr_t)pv + uBytes - 1) >> PAGE_BITS;
+   for (; uPage <= uLastPage; uPage++)
+   {
+      psLeaf = PageMap_findLeaf(uPage, TRUE);
+      if (psLeaf == NULL)
+         return FALSE;
+      uIndex = (size_t)uPage & (LEAF_ENTRIES - 1);
+      psLeaf->aucKind[uIndex] = (unsigned char)eKind;
+      psLeaf->apvOwner[uIndex] = pvOwner;
+   }
+   return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+enum PageKind PageMap_getKind(const void *pv)
+{
+   struct PageMapLeaf *psLeaf;
+   uintptr_t uPage = (uintptr_t)pv >> PAGE_BITS;
+
+   psLeaf = PageMap_findLeaf(uPage, FALSE);
+   if (psLeaf == NULL)
+      return PAGE_NONE;
+   return (enum PageKind)
+      psLeaf->aucKind[(size_t)uPage & (LEAF_ENTRIES - 1)];
+}
+
+/*--------------------------------------------------------------------*/
+
+void *PageMap_getOwner(const void *pv)
+{
+   struct PageMapLeaf *psLeaf;
+   uintptr_t uPage = (uintptr_t)pv >> PAGE_BITS;
+
+   psLeaf = PageMap_findLeaf(uPage, FALSE);
+   if (psLeaf == NULL)
+      return NULL;
+   return psLeaf->apvOwner[(size_t)uPage & (LEAF_ENTRIES - 1)];
+}
+
+/*--------------------------------------------------------------------*/
+
+int PageMap_covers(const void *pv, size_t uBytes, enum PageKind eKind,
+   const void *pvOwner)
+{
+   const char *pcPage;
+   const char *pcEnd = (const char*)pv + uBytes;
+
+   if (uBytes == 0)
+      return TRUE;
+
+   for (pcPage = (const char*)pv; pcPage < pcEnd;
+        pcPage += PAGE_BYTES)
+   {
+      if ((PageMap_getKind(pcPage) != eKind)
+         || (PageMap_getOwner(pcPage) != pvOwner))
+         return FALSE;
+   }
+
+   /* The last page may start less than a page before pcEnd. */
+   return (PageMap_getKind(pcEnd - 1) == eKind)
+      && (PageMap_getOwner(pcEnd - 1) == pvOwner);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t PageMap_getMappedBytes(void)
+{
+   return uMappedBytes;
+}
@@ -0,0 +1,63 @@
+/*--------------------------------------------------------------------*/
+/* pagemap5.h                                                         */
+/* Author: Isaac Wolfe and Isaac Hart                                 */
+/*--------------------------------------------------------------------*/
+
+#ifndef PAGEMAP5_INCLUDED
+#define PAGEMAP5_INCLUDED
+
+#include <stddef.h>
+
+/* The page map records, for each page of the address space that the
+   heap manager uses, what kind of memory the page holds and the
+   address of its owner: the descriptor through which its memory is
+   managed. It is a radix tree indexed by page number, so that any
+   pointer can be looked up in constant time without reading the
+   memory it points to. Pages that were never recorded are of kind
+   PAGE_NONE. */
+
+/* The kinds of page. */
+enum PageKind {PAGE_NONE, PAGE_SLAB, PAGE_HEAP, PAGE_LARGE};
+
+/* The number of bytes in a page. */
+enum {PAGE_BYTES = 4096};
+
+/*--------------------------------------------------------------------*/
+
+/* Record every page that overlaps the uBytes bytes at pv as being of
+   kind eKind and owned by pvOwner. Return 1 (TRUE) if successful, or
+   0 (FALSE) if the memory for the page map could not be obtained, in
+   which case some of the pages may have been recorded. */
+
+int PageMap_set(const void *pv, size_t uBytes, enum PageKind eKind,
+   void *pvOwner);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the kind of the page that holds pv. */
+
+enum PageKind PageMap_getKind(const void *pv);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the owner of the page that holds pv, or NULL if the page is
+   of kind PAGE_NONE. */
+
+void *PageMap_getOwner(const void *pv);
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) if every page that overlaps the uBytes bytes at pv
+   is of kind eKind and owned by pvOwner, or 0 (FALSE) otherwise. */
+
+int PageMap_covers(const void *pv, size_t uBytes, enum PageKind eKind,
+   const void *pvOwner);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes of memory that the page map has obtained
+   from the OS. */
+
+size_t PageMap_getMappedBytes(void);
+
+#endif
@@ -0,0 +1,630 @@
+/*--------------------------------------------------------------------*/
+/* segment5.c                                                         */
+/* Author: Isaac Wolfe and Isaac Hart                                 */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE
+
+#include "segment5.h"
+#include "pagemap5.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <assert.h>
+#include <sys/mman.h>
+
+/* In lieu of a boolean data type. */
+enum {FALSE, TRUE};
+
+/*--------------------------------------------------------------------*/
+
+/* A Segment's descriptor, the payload of its first sentinel. */
+
+struct Segment
+{
+   /* The next and previous Segments in the list. */
+   Segment_T oNext;
+   Segment_T oPrev;
+
+   /* The memory reserved for the Segment, which is committed from
+      pcReserveStart to pcCommitEnd. */
+   char *pcReserveStart;
+   char *pcReserveEnd;
+   char *pcCommitEnd;
+
+   /* The start of the committed memory that no Chunk has reached since
+      it was committed, and so still holds the zeros that the OS
+      provided. */
+   char *pcCleanStart;
+
+   /* The end Chunk. */
+   Chunk_T oEnd;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* The state of the Segments. */
+
+/* The newest Segment, or NULL if there is none. */
+static Segment_T oFirstSegment = NULL;
+
+/* The number of bytes committed to Segments. */
+static size_t uMappedBytes = 0;
+
+/* The number of calls to the OS made for Segments, and the number of
+   bytes committed by them in all. */
+static size_t uOsCalls = 0;
+static size_t uRequestedBytes = 0;
+
+/* Whether the heap has been started, which the first Segment does. */
+static int bHeapStarted = FALSE;
+
+/*--------------------------------------------------------------------*/
+
+/* Static function declarations */
+
+/* Return the number of units of a Segment's first sentinel. */
+static size_t Segment_getSentinelUnits(void);
+
+/* Write the header of a sentinel of uUnits units at oChunk, in use,
+   with previous status ePrevStatus. */
+static void Segment_setSentinel(Chunk_T oChunk, size_t uUnits,
+   enum ChunkStatus ePrevStatus);
+
+/* Reserve uBytes bytes, or at least uMinBytes, at pcHint if possible.
+   Store the number reserved in *puBytes. Return the reservation, or
+   NULL if the OS refused. */
+static void *Segment_reserve(char *pcHint, size_t uBytes,
+   size_t uMinBytes, size_t *puBytes);
+
+/* Commit the pages of oSegment up to pcEnd. Return TRUE if successful,
+   and FALSE otherwise. */
+static int Segment_commit(Segment_T oSegment, char *pcEnd);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of units of a Segment's first sentinel: enough to
+   hold its descriptor as a payload. */
+
+static size_t Segment_getSentinelUnits(void)
+{
+   return Chunk_bytesToUnits(sizeof(struct Segment));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Write the header of a sentinel of uUnits units at oChunk. A sentinel
+   is in use, has no footer and is part of the heap. Record ePrevStatus
+   as the status of the Chunk before it. */
+
+static void Segment_setSentinel(Chunk_T oChunk, size_t uUnits,
+   enum ChunkStatus ePrevStatus)
+{
+   /* Set the status first, so that no footer is written. */
+   Chunk_setStatus(oChunk, CHUNK_INUSE);
+   Chunk_setUnits(oChunk, uUnits);
+   Chunk_setPrevStatus(oChunk, ePrevStatus);
+   Chunk_setMapped(oChunk, FALSE);
+   Chunk_setPurged(oChunk, FALSE);
+   Chunk_setZero(oChunk, FALSE);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Reserve uBytes bytes of inaccessible address space, preferably at
+   pcHint, settling for half as much at a time, but no less than
+   uMinBytes, if the OS refuses. In huge page mode, align the
+   reservation to a huge page by reserving one more and returning the
+   excess, and ask the OS to back it with huge pages. Store the number
+   of bytes reserved in *puBytes. Return the reservation, or NULL if
+   the OS refused. */
+
+static void *Segment_reserve(char *pcHint, size_t uBytes,
+   size_t uMinBytes, size_t *puBytes)
+{
+   const size_t EXTRA_BYTES = SEGMENT_PAGE_BYTES - PAGE_BYTES;
+   char *pc;
+   size_t uHeadBytes;
+
+   assert(puBytes != NULL);
+
+   for (;;)
+   {
+      uOsCalls++;
+      pc = (char*)mmap(pcHint, uBytes + EXTRA_BYTES, PROT_NONE,
+         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+      if (pc != (char*)MAP_FAILED)
+         break;
+      if (uBytes / 2 < uMinBytes)
+         return NULL;
+      uBytes /= 2;
+   }
+
+   if (EXTRA_BYTES != 0)
+   {
+      uHeadBytes = (SEGMENT_PAGE_BYTES
+         - (uintptr_t)pc % SEGMENT_PAGE_BYTES) % SEGMENT_PAGE_BYTES;
+      if (uHeadBytes != 0)
+      {
+         uOsCalls++;
+         munmap(pc, uHeadBytes);
+      }
+      if (uHeadBytes != EXTRA_BYTES)
+      {
+         uOsCalls++;
+         munmap(pc + uHeadBytes + uBytes, EXTRA_BYTES - uHeadBytes);
+      }
+      pc += uHeadBytes;
+   }
+#if defined(SEGMENT_HUGE_PAGES) && defined(MADV_HUGEPAGE)
+   uOsCalls++;
+   madvise(pc, uBytes, MADV_HUGEPAGE);
+#endif
+
+   *puBytes = uBytes;
+   return pc;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Make the pages of oSegment's reservation up to pcEnd readable and
+   writable, committing at least SEGMENT_COMMIT_BYTES at a time. Return
+   TRUE if successful, and FALSE if pcEnd is beyond the reservation or
+   the OS refused. */
+
+static int Segment_commit(Segment_T oSegment, char *pcEnd)
+{
+   size_t uBytes;
+   size_t uAvailBytes;
+
+   assert(oSegment != NULL);
+
+   if (pcEnd <= oSegment->pcCommitEnd)
+      return TRUE;
+   if (pcEnd > oSegment->pcReserveEnd)
+      return FALSE;
+
+   uBytes = (size_t)(pcEnd - oSegment->pcCommitEnd);
+   uBytes = ((uBytes + SEGMENT_COMMIT_BYTES - 1) / SEGMENT_COMMIT_BYTES)
+      * SEGMENT_COMMIT_BYTES;
+   uAvailBytes =
+      (size_t)(oSegment->pcReserveEnd - oSegment->pcCommitEnd);
+   if (uBytes > uAvailBytes)
+      uBytes = uAvailBytes;
+
+   uOsCalls++;
+   if (mprotect(oSegment->pcCommitEnd, uBytes, PROT_READ | PROT_WRITE)
+      == -1)
+      return FALSE;
+   oSegment->pcCommitEnd += uBytes;
+   uMappedBytes += uBytes;
+   uRequestedBytes += uBytes;
+   return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+Segment_T Segment_new(size_t uUnits)
+{
+   Segment_T oSegment;
+   Chunk_T oSentinel;
+   Chunk_T oEnd;
+   size_t uSentinelUnits = Segment_getSentinelUnits();
+   size_t uMinBytes;
+   size_t uWantBytes;
+   size_t uBytes;
+   size_t uCommitBytes;
+   char *pcHint = NULL;
+   void *pv;
+
+   /* Reserve room for the sentinels, uUnits units and the alignment of
+      the first sentinel. */
+   if (uUnits > MAX_UNITS_PER_CHUNK)
+      return NULL;
+   uMinBytes = Chunk_unitsToBytes(uSentinelUnits + MIN_UNITS_PER_CHUNK
+      + uUnits + 1);
+   uMinBytes = ((uMinBytes + SEGMENT_COMMIT_BYTES - 1)
+      / SEGMENT_COMMIT_BYTES) * SEGMENT_COMMIT_BYTES;
+   uWantBytes = SEGMENT_RESERVE_BYTES;
+   if (uWantBytes < uMinBytes)
+      uWantBytes = uMinBytes;
+
+   /* Ask for the addresses after the newest Segment, so that the heap
+      stays compact. */
+   if (oFirstSegment != NULL)
+      pcHint = oFirstSegment->pcReserveEnd;
+   pv = Segment_reserve(pcHint, uWantBytes, uMinBytes, &uBytes);
+   if (pv == NULL)
+      return NULL;
+
+   if (! bHeapStarted)
+      oSentinel = Chunk_startHeap(pv);
+   else
+   {
+      oSentinel = Chunk_startSegment(pv, uBytes);
+
+      /* If the OS put the Segment where its Chunks cannot be
+         represented, ask for the addresses before the newest
+         Segment instead. */
+      if ((oSentinel == NULL)
+         && ((size_t)oFirstSegment->pcReserveStart > uWantBytes))
+      {
+         uOsCalls++;
+         munmap(pv, uBytes);
+         pcHint = oFirstSegment->pcReserveStart - uWantBytes;
+         pv = Segment_reserve(pcHint, uWantBytes, uMinBytes, &uBytes);
+         if (pv == NULL)
+            return NULL;
+         oSentinel = Chunk_startSegment(pv, uBytes);
+      }
+   }
+   uCommitBytes = SEGMENT_COMMIT_BYTES;
+   if (uCommitBytes > uBytes)
+      uCommitBytes = uBytes;
+   if (oSentinel == NULL)
+   {
+      uOsCalls++;
+      munmap(pv, uBytes);
+      return NULL;
+   }
+   uOsCalls++;
+   if (mprotect(pv, uCommitBytes, PROT_READ | PROT_WRITE) == -1)
+   {
+      uOsCalls++;
+      munmap(pv, uBytes);
+      return NULL;
+   }
+   bHeapStarted = TRUE;
+
+   /* Record the sentinels in the page map. */
+   oSegment = (Segment_T)Chunk_toPayload(oSentinel);
+   oEnd = (Chunk_T)((char*)oSentinel
+      + Chunk_unitsToBytes(uSentinelUnits));
+   if (! PageMap_set(oSentinel,
+      Chunk_unitsToBytes(uSentinelUnits + MIN_UNITS_PER_CHUNK),
+      PAGE_HEAP, oSegment))
+   {
+      uOsCalls++;
+      munmap(pv, uBytes);
+      return NULL;
+   }
+
+   Segment_setSentinel(oSentinel, uSentinelUnits, CHUNK_INUSE);
+   Segment_setSentinel(oEnd, MIN_UNITS_PER_CHUNK, CHUNK_INUSE);
+   oSegment->pcReserveStart = (char*)pv;
+   oSegment->pcReserveEnd = (char*)pv + uBytes;
+   oSegment->pcCommitEnd = (char*)pv + uCommitBytes;
+   oSegment->oEnd = oEnd;
+   oSegment->pcCleanStart = (char*)Segment_getLimit(oSegment);
+   uMappedBytes += uCommitBytes;
+   uRequestedBytes += uCommitBytes;
+
+   /* Add the Segment to the front of the list. */
+   oSegment->oPrev = NULL;
+   oSegment->oNext = oFirstSegment;
+   if (oFirstSegment != NULL)
+      oFirstSegment->oPrev = oSegment;
+   oFirstSegment = oSegment;
+   return oSegment;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Segment_free(Segment_T oSegment)
+{
+   Chunk_T oSentinel;
+   char *pcReserveStart;
+   size_t uReserveBytes;
+
+   assert(oSegment != NULL);
+
+   /* Remove the Segment from the list. */
+   if (oSegment->oPrev != NULL)
+      oSegment->oPrev->oNext = oSegment->oNext;
+   else
+      oFirstSegment = oSegment->oNext;
+   if (oSegment->oNext != NULL)
+      oSegment->oNext->oPrev = oSegment->oPrev;
+
+   /* Remove its pages from the page map, and unmap it. */
+   oSentinel = Chunk_fromPayload(oSegment);
+   PageMap_set(oSentinel,
+      (size_t)((char*)Segment_getLimit(oSegment) - (char*)oSentinel),
+      PAGE_NONE, NULL);
+   pcReserveStart = oSegment->pcReserveStart;
+   uReserveBytes =
+      (size_t)(oSegment->pcReserveEnd - oSegment->pcReserveStart);
+   uMappedBytes -= (size_t)(oSegment->pcCommitEnd - pcReserveStart);
+   uOsCalls++;
+   munmap(pcReserveStart, uReserveBytes);
+}
+
+/*--------------------------------------------------------------------*/
+
+Chunk_T Segment_grow(Segment_T oSegment, size_t uUnits)
+{
+   Chunk_T oChunk;
+   Chunk_T oNewEnd;
+   size_t uBytes;
+
+   assert(oSegment != NULL);
+   assert(uUnits >= MIN_UNITS_PER_CHUNK);
+   assert(uUnits <= MAX_UNITS_PER_CHUNK);
+
+   /* Is there room in the reservation? */
+   oChunk = oSegment->oEnd;
+   uBytes = Chunk_unitsToBytes(uUnits + MIN_UNITS_PER_CHUNK);
+   if (uBytes > (size_t)(oSegment->pcReserveEnd - (char*)oChunk))
+      return NULL;
+
+   if (! Segment_commit(oSegment, (char*)oChunk + uBytes))
+      return NULL;
+   if (! PageMap_set(oChunk, uBytes, PAGE_HEAP, oSegment))
+      return NULL;
+
+   /* The end Chunk's memory becomes a Chunk in use, which keeps its
+      previous status, and a new end Chunk follows it. The Chunk is
+      zero if no Chunk has reached past the end Chunk's memory. */
+   oNewEnd = (Chunk_T)((char*)oChunk + Chunk_unitsToBytes(uUnits));
+   Segment_setSentinel(oNewEnd, MIN_UNITS_PER_CHUNK, CHUNK_INUSE);
+   Chunk_setUnits(oChunk, uUnits);
+   Chunk_setZero(oChunk,
+      oSegment->pcCleanStart <= (char*)Segment_getLimit(oSegment));
+   oSegment->oEnd = oNewEnd;
+   if (oSegment->pcCleanStart < (char*)Segment_getLimit(oSegment))
+      oSegment->pcCleanStart = (char*)Segment_getLimit(oSegment);
+   return oChunk;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Segment_shrink(Segment_T oSegment, Chunk_T oNewEnd,
+   enum ChunkStatus ePrevStatus)
+{
+   char *pcOldLimit;
+   char *pcNewLimit;
+   char *pcDecommit;
+   char *pcFirstPage;
+   size_t uBytes;
+
+   assert(oSegment != NULL);
+   assert(oNewEnd >= Segment_getFirstChunk(oSegment));
+   assert(oNewEnd <= oSegment->oEnd);
+
+   pcOldLimit = (char*)Segment_getLimit(oSegment);
+   pcNewLimit =
+      (char*)oNewEnd + Chunk_unitsToBytes(MIN_UNITS_PER_CHUNK);
+
+   /* Map fresh inaccessible memory over the committed Segment pages
+      wholly beyond the new end Chunk, so that the OS takes back their
+      contents without splitting a huge page. The fresh memory must be
+      marked for huge pages again. */
+   pcDecommit = pcNewLimit + SEGMENT_PAGE_BYTES - 1;
+   pcDecommit -= (size_t)pcDecommit % SEGMENT_PAGE_BYTES;
+   if (pcDecommit < oSegment->pcCommitEnd)
+   {
+      uBytes = (size_t)(oSegment->pcCommitEnd - pcDecommit);
+      uOsCalls++;
+      if (mmap(pcDecommit, uBytes, PROT_NONE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED,
+            -1, 0)
+         == MAP_FAILED)
+         return FALSE;
+#if defined(SEGMENT_HUGE_PAGES) && defined(MADV_HUGEPAGE)
+      uOsCalls++;
+      madvise(pcDecommit, uBytes, MADV_HUGEPAGE);
+#endif
+      uMappedBytes -= uBytes;
+      oSegment->pcCommitEnd = pcDecommit;
+      if (oSegment->pcCleanStart > pcDecommit)
+         oSegment->pcCleanStart = pcDecommit;
+   }
+
+   /* Remove the pages wholly beyond the new end Chunk from the page
+      map. */
+   pcFirstPage = pcNewLimit + PAGE_BYTES - 1;
+   pcFirstPage -= (size_t)pcFirstPage % PAGE_BYTES;
+   if (pcFirstPage < pcOldLimit)
+      PageMap_set(pcFirstPage, (size_t)(pcOldLimit - pcFirstPage),
+         PAGE_NONE, NULL);
+
+   Segment_setSentinel(oNewEnd, MIN_UNITS_PER_CHUNK, ePrevStatus);
+   oSegment->oEnd = oNewEnd;
+   return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+Segment_T Segment_fromChunk(Chunk_T oChunk)
+{
+   if (PageMap_getKind(oChunk) != PAGE_HEAP)
+      return NULL;
+   return (Segment_T)PageMap_getOwner(oChunk);
+}
+
+/*--------------------------------------------------------------------*/
+
+Chunk_T Segment_getFirstChunk(Segment_T oSegment)
+{
+   assert(oSegment != NULL);
+
+   return (Chunk_T)((char*)Chunk_fromPayload(oSegment)
+      + Chunk_unitsToBytes(Segment_getSentinelUnits()));
+}
+
+/*--------------------------------------------------------------------*/
+
+Chunk_T Segment_getEnd(Segment_T oSegment)
+{
+   assert(oSegment != NULL);
+
+   return oSegment->oEnd;
+}
+
+/*--------------------------------------------------------------------*/
+
+Chunk_T Segment_getLimit(Segment_T oSegment)
+{
+   assert(oSegment != NULL);
+
+   return (Chunk_T)((char*)oSegment->oEnd
+      + Chunk_unitsToBytes(MIN_UNITS_PER_CHUNK));
+}
+
+/*--------------------------------------------------------------------*/
+
+void Segment_prefault(void *pv, size_t uBytes)
+{
+   char *pcStart;
+   char *pcEnd;
+   char *pc;
+
+   assert(pv != NULL);
+
+   pcStart = (char*)pv - (size_t)pv % PAGE_BYTES;
+   pcEnd = (char*)pv + uBytes + PAGE_BYTES - 1;
+   pcEnd -= (size_t)pcEnd % PAGE_BYTES;
+   if (pcStart >= pcEnd)
+      return;
+
+   /* Ask the OS to populate the pages in one call if it can, or else
+      fault each in by writing back a byte that it holds. */
+#ifdef MADV_POPULATE_WRITE
+   uOsCalls++;
+   if (madvise(pcStart, (size_t)(pcEnd - pcStart), MADV_POPULATE_WRITE)
+      == 0)
+      return;
+#endif
+   for (pc = pcStart; pc < pcEnd; pc += PAGE_BYTES)
+      *(volatile char*)pc = *(volatile char*)pc;
+}
+
+/*--------------------------------------------------------------------*/
+
+Segment_T Segment_getFirst(void)
+{
+   return oFirstSegment;
+}
+
+/*--------------------------------------------------------------------*/
+
+Segment_T Segment_getNext(Segment_T oSegment)
+{
+   assert(oSegment != NULL);
+
+   return oSegment->oNext;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Segment_getMappedBytes(void)
+{
+   return uMappedBytes;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Segment_getOsCalls(void)
+{
+   return uOsCalls;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Segment_getRequestedBytes(void)
+{
+   return uRequestedBytes;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Segment_isValid(void)
+{
+   Segment_T oSegment;
+   Segment_T oPrevSegment = NULL;
+   Chunk_T oSentinel;
+   char *pcLimit;
+   size_t uBytes = 0;
+
+   for (oSegment = oFirstSegment;
+        oSegment != NULL;
+        oSegment = oSegment->oNext)
+   {
+      /* Is the Segment linked back to the one before it? That also
+         rules out a cycle. */
+      if (oSegment->oPrev != oPrevSegment)
+      {
+         fprintf(stderr, "A segment is misaligned in the list\n");
+         return FALSE;
+      }
+      oPrevSegment = oSegment;
+
+      /* Do its sentinels and committed memory lie within its
+         reservation, in order? */
+      oSentinel = Chunk_fromPayload(oSegment);
+      pcLimit = (char*)Segment_getLimit(oSegment);
+      if (((char*)oSentinel < oSegment->pcReserveStart)
+         || (oSegment->oEnd < Segment_getFirstChunk(oSegment))
+         || (pcLimit > oSegment->pcCommitEnd)
+         || (oSegment->pcCommitEnd > oSegment->pcReserveEnd))
+      {
+         fprintf(stderr, "A segment is not within its memory\n");
+         return FALSE;
+      }
+
+      /* Does the memory known to be zero lie beyond its end Chunk,
+         within its committed memory? */
+      if ((oSegment->pcCleanStart < pcLimit)
+         || (oSegment->pcCleanStart > oSegment->pcCommitEnd))
+      {
+         fprintf(stderr, "A segment has a bad zero boundary\n");
+         return FALSE;
+      }
+
+      /* Does it start at a Segment page? */
+      if ((size_t)oSegment->pcReserveStart % SEGMENT_PAGE_BYTES != 0)
+      {
+         fprintf(stderr, "A segment is not aligned to a page\n");
+         return FALSE;
+      }
+
+      /* Are its sentinels in use, of the right size, and part of the
+         heap? */
+      if ((Chunk_getStatus(oSentinel) != CHUNK_INUSE)
+         || (Chunk_getUnits(oSentinel) != Segment_getSentinelUnits())
+         || (Chunk_getPrevStatus(oSentinel) != CHUNK_INUSE)
+         || Chunk_isMapped(oSentinel)
+         || (Chunk_getStatus(oSegment->oEnd) != CHUNK_INUSE)
+         || (Chunk_getUnits(oSegment->oEnd) != MIN_UNITS_PER_CHUNK)
+         || Chunk_isMapped(oSegment->oEnd))
+      {
+         fprintf(stderr, "A segment has a bad sentinel\n");
+         return FALSE;
+      }
+
+      /* Is the Segment in the page map, and nothing beyond it? */
+      if (! PageMap_covers(oSentinel,
+         (size_t)(pcLimit - (char*)oSentinel), PAGE_HEAP, oSegment))
+      {
+         fprintf(stderr, "A segment is not in the page map\n");
+         return FALSE;
+      }
+      if (PageMap_getOwner(pcLimit + PAGE_BYTES - 1) == oSegment)
+      {
+         fprintf(stderr,
+            "A page beyond a segment is in the page map\n");
+         return FALSE;
+      }
+
+      uBytes += (size_t)(oSegment->pcCommitEnd
+         - oSegment->pcReserveStart);
+   }
+
+   if (uBytes != uMappedBytes)
+   {
+      fprintf(stderr, "The segments' committed size is wrong\n");
+      return FALSE;
+   }
+
+   return TRUE;
+}
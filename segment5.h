@@ -0,0 +1,169 @@
+/*--------------------------------------------------------------------*/
+/* segment5.h                                                         */
+/* Author: Isaac Wolfe and Isaac Hart                                 */
+/*--------------------------------------------------------------------*/
+
+#ifndef SEGMENT5_INCLUDED
+#define SEGMENT5_INCLUDED
+
+#include "chunk5.h"
+#include "pagemap5.h"
+#include <stddef.h>
+
+/* The heap is a list of Segments, newest first. A Segment is a region
+   of address space reserved from the OS, of which only the part in use
+   is committed; the rest is inaccessible. Its Chunks lie between two
+   sentinels, Chunks in use that are never freed, so that no Chunk
+   coalesces across the edge of a Segment: the first sentinel's payload
+   holds the Segment's descriptor, and the last, the end Chunk, marks
+   how far the Segment has grown. Every page of a Segment's Chunks is
+   recorded in the page map (see pagemap5.h) as a page of kind
+   PAGE_HEAP that the Segment owns, so that the Segment of a Chunk is
+   found by looking up the Chunk's address. The sizes below can be
+   changed by defining the macros when compiling. */
+
+/* The number of bytes of address space reserved for a Segment, unless
+   it must be larger to serve the request that created it. */
+#ifndef SEGMENT_RESERVE_BYTES
+#define SEGMENT_RESERVE_BYTES ((size_t)32 << 30)
+#endif
+
+/* The size of the pages in which Segments are committed and returned
+   to the OS. Defining SEGMENT_HUGE_PAGES when compiling makes it the
+   size of a transparent huge page: every Segment is then aligned to
+   it and asks the OS to back it with huge pages, and no huge page is
+   ever partly returned. */
+#ifdef SEGMENT_HUGE_PAGES
+#define SEGMENT_PAGE_BYTES ((size_t)2 * 1024 * 1024)
+#else
+#define SEGMENT_PAGE_BYTES ((size_t)PAGE_BYTES)
+#endif
+
+/* The number of bytes by which a Segment's committed memory grows at
+   least. It must be a multiple of SEGMENT_PAGE_BYTES. */
+#ifndef SEGMENT_COMMIT_BYTES
+#ifdef SEGMENT_HUGE_PAGES
+#define SEGMENT_COMMIT_BYTES SEGMENT_PAGE_BYTES
+#else
+#define SEGMENT_COMMIT_BYTES ((size_t)64 * 1024)
+#endif
+#endif
+
+/* A Segment. */
+typedef struct Segment *Segment_T;
+
+/*--------------------------------------------------------------------*/
+
+/* Reserve a new Segment that can grow by uUnits units, and add it to
+   the front of the list. It holds no Chunks yet: its end Chunk follows
+   its first sentinel. Return the Segment, or NULL if the OS refused or
+   Chunks in its memory could not be represented. */
+
+Segment_T Segment_new(size_t uUnits);
+
+/*--------------------------------------------------------------------*/
+
+/* Remove oSegment from the list and return its memory to the OS. */
+
+void Segment_free(Segment_T oSegment);
+
+/*--------------------------------------------------------------------*/
+
+/* Move oSegment's end Chunk uUnits units further, committing its
+   memory as needed. Return the memory that the end Chunk occupied as
+   a Chunk of uUnits units, in use, whose previous status is that
+   which the end Chunk recorded. The new end Chunk records that the
+   returned Chunk is in use. Mark the returned Chunk zero (see
+   chunk5.h) if no Chunk has used its memory since the OS provided it.
+   Return NULL if oSegment's reservation is exhausted or the OS
+   refused. */
+
+Chunk_T Segment_grow(Segment_T oSegment, size_t uUnits);
+
+/*--------------------------------------------------------------------*/
+
+/* Move oSegment's end Chunk back to oNewEnd, which must be the start
+   of a free Chunk of oSegment, or a point within it at least
+   MIN_UNITS_PER_CHUNK units from its start, and record ePrevStatus as
+   the status of the Chunk before it. Return the Segment pages wholly
+   beyond the new end Chunk to the OS, and remove the pages beyond it
+   from the page map. Return 1 (TRUE) if successful, or 0 (FALSE) if
+   the OS refused, in which case oSegment is unchanged. */
+
+int Segment_shrink(Segment_T oSegment, Chunk_T oNewEnd,
+   enum ChunkStatus ePrevStatus);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the Segment that holds oChunk, or NULL if there is none. */
+
+Segment_T Segment_fromChunk(Chunk_T oChunk);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the first Chunk of oSegment after its first sentinel. If
+   oSegment holds no Chunks, that is its end Chunk. */
+
+Chunk_T Segment_getFirstChunk(Segment_T oSegment);
+
+/*--------------------------------------------------------------------*/
+
+/* Return oSegment's end Chunk. */
+
+Chunk_T Segment_getEnd(Segment_T oSegment);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the address immediately beyond oSegment's end Chunk. */
+
+Chunk_T Segment_getLimit(Segment_T oSegment);
+
+/*--------------------------------------------------------------------*/
+
+/* Have the OS back the uBytes bytes of committed Segment memory at pv
+   with pages now, without changing their contents. */
+
+void Segment_prefault(void *pv, size_t uBytes);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the newest Segment, or NULL if there is none. */
+
+Segment_T Segment_getFirst(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the Segment after oSegment in the list, or NULL if there is
+   none. */
+
+Segment_T Segment_getNext(Segment_T oSegment);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes of memory committed to Segments. */
+
+size_t Segment_getMappedBytes(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of calls to the OS made to reserve, commit and
+   return the memory of Segments. */
+
+size_t Segment_getOsCalls(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes of memory committed to Segments in all,
+   including any since returned to the OS. */
+
+size_t Segment_getRequestedBytes(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) if the list of Segments, their sentinels, their
+   committed memory and their entries in the page map are valid, or 0
+   (FALSE) otherwise. */
+
+int Segment_isValid(void);
+
+#endif
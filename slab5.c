@@ -0,0 +1,435 @@
+/*--------------------------------------------------------------------*/
+/* slab5.c                                                            */
+/* Author: Isaac Wolfe and Isaac Hart                                 */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE
+
+#include "slab5.h"
+#include "pagemap5.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <assert.h>
+#include <sys/mman.h>
+
+/* In lieu of a boolean data type. */
+enum {FALSE, TRUE};
+
+/*--------------------------------------------------------------------*/
+
+/* The number of bytes in a slab, which must be a multiple of the page
+   size, and the alignment of every object. */
+enum {SLAB_BYTES = 4096};
+enum {SLAB_ALIGNMENT = 16};
+
+/* The number of size classes. Class i holds objects of
+   (i + 1) * SLAB_ALIGNMENT bytes. */
+enum {SLAB_CLASS_COUNT = SLAB_MAX_BYTES / SLAB_ALIGNMENT};
+
+/* The number of slabs committed at once. */
+enum {SLABS_PER_COMMIT = 16};
+
+/* The number of bytes of address space reserved for slabs. Only the
+   slabs in use or once used are committed. */
+#ifndef SLAB_ARENA_BYTES
+#define SLAB_ARENA_BYTES ((size_t)1 << 36)
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* A slab header, at the start of each slab. */
+
+struct Slab
+{
+   /* The next and previous slabs in the slab's list. A slab is in the
+      partial list of its class iff some but not all of its objects
+      are in use, and in the empty list iff none are. The empty list
+      uses psNext alone. */
+   struct Slab *psNext;
+   struct Slab *psPrev;
+
+   /* The slab's free objects, each of which holds the address of the
+      next. */
+   void *pvFreeList;
+
+   /* The slab's size class, object size and number of objects. */
+   unsigned int uiClass;
+   unsigned int uiObjectBytes;
+   unsigned int uiCapacity;
+
+   /* The number of objects in use, and the number ever carved from the
+      slab. Objects beyond the carved ones have never been used, so
+      they need not be put in the free list. */
+   unsigned int uiInUse;
+   unsigned int uiCarved;
+};
+
+/* The number of bytes before the first object of a slab. */
+enum {SLAB_HEADER_BYTES = (int)(((sizeof(struct Slab) + SLAB_ALIGNMENT
+   - 1) / SLAB_ALIGNMENT) * SLAB_ALIGNMENT)};
+
+/*--------------------------------------------------------------------*/
+
+/* The state of the slabs. */
+
+/* The start of the reserved region, the end of its committed part,
+   and its end. */
+static char *pcArenaStart = NULL;
+static char *pcArenaEnd = NULL;
+static char *pcArenaLimit = NULL;
+
+/* The first committed slab that has never been used. */
+static char *pcArenaUnused = NULL;
+
+/* The partial list of each size class. */
+static struct Slab *apsPartial[SLAB_CLASS_COUNT];
+
+/* The empty list. */
+static struct Slab *psEmpty = NULL;
+
+/*--------------------------------------------------------------------*/
+
+/* Static function declarations */
+
+/* Return a slab that holds no objects, committing more of the
+   reserved region if necessary, or NULL if the OS refused. */
+static struct Slab *Slab_getEmpty(void);
+
+/* Insert psSlab at the front of the partial list of its class. */
+static void Slab_push(struct Slab *psSlab);
+
+/* Remove psSlab from the partial list of its class. */
+static void Slab_unlink(struct Slab *psSlab);
+
+/* Return TRUE if psSlab, which holds objects, is valid, and FALSE
+   otherwise. */
+static int Slab_slabIsValid(struct Slab *psSlab);
+
+/*--------------------------------------------------------------------*/
+
+/* Return a slab that holds no objects: the front of the empty list,
+   or else the first slab never used, which is then recorded in the
+   page map as its own owner. Reserve the region on the first call,
+   and commit SLABS_PER_COMMIT slabs whenever the committed part is
+   used up. Return NULL if the OS refused. */
+
+static struct Slab *Slab_getEmpty(void)
+{
+   struct Slab *psSlab;
+   void *pv;
+   const size_t uCommitBytes = (size_t)SLAB_BYTES * SLABS_PER_COMMIT;
+
+   if (psEmpty != NULL)
+   {
+      psSlab = psEmpty;
+      psEmpty = psSlab->psNext;
+      return psSlab;
+   }
+
+   if (pcArenaStart == NULL)
+   {
+      pv = mmap(NULL, SLAB_ARENA_BYTES, PROT_NONE,
+         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+      if (pv == MAP_FAILED)
+         return NULL;
+      pcArenaStart = (char*)pv;
+      pcArenaEnd = pcArenaStart;
+      pcArenaUnused = pcArenaStart;
+      pcArenaLimit = pcArenaStart + SLAB_ARENA_BYTES;
+   }
+
+   if (pcArenaUnused == pcArenaEnd)
+   {
+      if ((size_t)(pcArenaLimit - pcArenaEnd) < uCommitBytes)
+         return NULL;
+      if (mprotect(pcArenaEnd, uCommitBytes,
+         PROT_READ | PROT_WRITE) == -1)
+         return NULL;
+      pcArenaEnd += uCommitBytes;
+   }
+
+   psSlab = (struct Slab*)pcArenaUnused;
+   if (! PageMap_set(psSlab, SLAB_BYTES, PAGE_SLAB, psSlab))
+      return NULL;
+   pcArenaUnused += SLAB_BYTES;
+   return psSlab;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Insert psSlab at the front of the partial list of its class. */
+
+static void Slab_push(struct Slab *psSlab)
+{
+   struct Slab *psFront = apsPartial[psSlab->uiClass];
+
+   if (psFront != NULL)
+      psFront->psPrev = psSlab;
+   psSlab->psNext = psFront;
+   psSlab->psPrev = NULL;
+   apsPartial[psSlab->uiClass] = psSlab;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Remove psSlab from the partial list of its class. */
+
+static void Slab_unlink(struct Slab *psSlab)
+{
+   if (psSlab->psNext != NULL)
+      psSlab->psNext->psPrev = psSlab->psPrev;
+   if (psSlab->psPrev != NULL)
+      psSlab->psPrev->psNext = psSlab->psNext;
+   else
+      apsPartial[psSlab->uiClass] = psSlab->psNext;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *Slab_alloc(size_t uBytes)
+{
+   struct Slab *psSlab;
+   void *pv;
+   unsigned int uiClass;
+
+   assert(uBytes > 0);
+   assert(uBytes <= SLAB_MAX_BYTES);
+
+   uiClass = (unsigned int)((uBytes - 1) / SLAB_ALIGNMENT);
+
+   /* Take the front slab of the class, or start a new one. */
+   psSlab = apsPartial[uiClass];
+   if (psSlab == NULL)
+   {
+      psSlab = Slab_getEmpty();
+      if (psSlab == NULL)
+         return NULL;
+      psSlab->pvFreeList = NULL;
+      psSlab->uiClass = uiClass;
+      psSlab->uiObjectBytes = (uiClass + 1) * SLAB_ALIGNMENT;
+      psSlab->uiCapacity = (SLAB_BYTES - SLAB_HEADER_BYTES)
+         / psSlab->uiObjectBytes;
+      psSlab->uiInUse = 0;
+      psSlab->uiCarved = 0;
+      Slab_push(psSlab);
+   }
+
+   /* Reuse a free object if there is one, or else carve a new one. */
+   if (psSlab->pvFreeList != NULL)
+   {
+      pv = psSlab->pvFreeList;
+      psSlab->pvFreeList = *(void**)pv;
+   }
+   else
+   {
+      pv = (char*)psSlab + SLAB_HEADER_BYTES
+         + ((size_t)psSlab->uiCarved * psSlab->uiObjectBytes);
+      psSlab->uiCarved++;
+   }
+
+   /* A full slab leaves the partial list. */
+   psSlab->uiInUse++;
+   if (psSlab->uiInUse == psSlab->uiCapacity)
+      Slab_unlink(psSlab);
+
+   return pv;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Slab_free(void *pv)
+{
+   struct Slab *psSlab;
+
+   assert(PageMap_getKind(pv) == PAGE_SLAB);
+
+   psSlab = (struct Slab*)PageMap_getOwner(pv);
+   assert(psSlab->uiInUse > 0);
+
+   /* A full slab rejoins the partial list. */
+   if (psSlab->uiInUse == psSlab->uiCapacity)
+      Slab_push(psSlab);
+
+   *(void**)pv = psSlab->pvFreeList;
+   psSlab->pvFreeList = pv;
+
+   /* An empty slab moves to the empty list, so that any class can
+      reuse it. */
+   psSlab->uiInUse--;
+   if (psSlab->uiInUse == 0)
+   {
+      Slab_unlink(psSlab);
+      psSlab->psNext = psEmpty;
+      psEmpty = psSlab;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Slab_getSize(const void *pv)
+{
+   struct Slab *psSlab;
+
+   assert(PageMap_getKind(pv) == PAGE_SLAB);
+
+   psSlab = (struct Slab*)PageMap_getOwner(pv);
+   return (size_t)psSlab->uiObjectBytes;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Slab_getMappedBytes(void)
+{
+   return (size_t)(pcArenaEnd - pcArenaStart);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return TRUE if psSlab, which holds objects, is valid: its sizes and
+   counts agree with its class, and its free list holds carved objects
+   of the slab, without a cycle, and exactly as many as are carved but
+   not in use. Return FALSE otherwise. */
+
+static int Slab_slabIsValid(struct Slab *psSlab)
+{
+   char *pcFirst = (char*)psSlab + SLAB_HEADER_BYTES;
+   char *pcObject;
+   unsigned int uiFree = 0;
+
+   if ((psSlab->uiClass >= (unsigned int)SLAB_CLASS_COUNT)
+      || (psSlab->uiObjectBytes
+         != (psSlab->uiClass + 1) * SLAB_ALIGNMENT)
+      || (psSlab->uiCapacity != (SLAB_BYTES - SLAB_HEADER_BYTES)
+         / psSlab->uiObjectBytes))
+   {
+      fprintf(stderr, "A slab has a bad size class\n");
+      return FALSE;
+   }
+   if ((psSlab->uiInUse > psSlab->uiCarved)
+      || (psSlab->uiCarved > psSlab->uiCapacity))
+   {
+      fprintf(stderr, "A slab has bad object counts\n");
+      return FALSE;
+   }
+
+   for (pcObject = (char*)psSlab->pvFreeList;
+        pcObject != NULL;
+        pcObject = *(char**)pcObject)
+   {
+      if ((pcObject < pcFirst)
+         || (pcObject >= pcFirst
+            + ((size_t)psSlab->uiCarved * psSlab->uiObjectBytes))
+         || ((size_t)(pcObject - pcFirst) % psSlab->uiObjectBytes
+            != 0))
+      {
+         fprintf(stderr, "A slab's free list has a bad object\n");
+         return FALSE;
+      }
+      uiFree++;
+      if (uiFree > psSlab->uiCarved)
+      {
+         fprintf(stderr, "A slab's free list has a cycle\n");
+         return FALSE;
+      }
+   }
+
+   if (uiFree + psSlab->uiInUse != psSlab->uiCarved)
+   {
+      fprintf(stderr, "A slab's free list has the wrong length\n");
+      return FALSE;
+   }
+   return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Slab_isValid(void)
+{
+   struct Slab *psSlab;
+   char *pcSlab;
+   int iClass;
+   size_t uPartialCount = 0;
+   size_t uEmptyCount = 0;
+   size_t uSlabCount;
+
+   if (pcArenaStart == NULL)
+      return TRUE;
+
+   /* Traverse every slab ever used. */
+   for (pcSlab = pcArenaStart; pcSlab < pcArenaUnused;
+        pcSlab += SLAB_BYTES)
+   {
+      psSlab = (struct Slab*)pcSlab;
+      if (! PageMap_covers(psSlab, SLAB_BYTES, PAGE_SLAB, psSlab))
+      {
+         fprintf(stderr, "A slab is not in the page map\n");
+         return FALSE;
+      }
+      if (psSlab->uiInUse == 0)
+         uEmptyCount++;
+      else
+      {
+         if (! Slab_slabIsValid(psSlab))
+            return FALSE;
+         if (psSlab->uiInUse < psSlab->uiCapacity)
+            uPartialCount++;
+      }
+   }
+
+   /* Traverse the partial lists. Each must hold only partly used slabs
+      of its class, and all of them. */
+   uSlabCount = 0;
+   for (iClass = 0; iClass < SLAB_CLASS_COUNT; iClass++)
+      for (psSlab = apsPartial[iClass]; psSlab != NULL;
+           psSlab = psSlab->psNext)
+      {
+         if ((psSlab->uiClass != (unsigned int)iClass)
+            || (psSlab->uiInUse == 0)
+            || (psSlab->uiInUse == psSlab->uiCapacity))
+         {
+            fprintf(stderr, "A partial list holds a bad slab\n");
+            return FALSE;
+         }
+         if ((psSlab->psNext != NULL)
+            && (psSlab->psNext->psPrev != psSlab))
+         {
+            fprintf(stderr, "A partial list is misaligned\n");
+            return FALSE;
+         }
+         uSlabCount++;
+         if (uSlabCount > uPartialCount)
+         {
+            fprintf(stderr, "The partial lists have too many slabs\n");
+            return FALSE;
+         }
+      }
+   if (uSlabCount != uPartialCount)
+   {
+      fprintf(stderr, "A partly used slab is in no partial list\n");
+      return FALSE;
+   }
+
+   /* Traverse the empty list. */
+   uSlabCount = 0;
+   for (psSlab = psEmpty; psSlab != NULL; psSlab = psSlab->psNext)
+   {
+      if (psSlab->uiInUse != 0)
+      {
+         fprintf(stderr, "The empty list holds a slab in use\n");
+         return FALSE;
+      }
+      uSlabCount++;
+      if (uSlabCount > uEmptyCount)
+      {
+         fprintf(stderr, "The empty list has too many slabs\n");
+         return FALSE;
+      }
+   }
+   if (uSlabCount != uEmptyCount)
+   {
+      fprintf(stderr, "An empty slab is not in the empty list\n");
+      return FALSE;
+   }
+
+   return TRUE;
+}
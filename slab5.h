@@ -0,0 +1,63 @@
+/*--------------------------------------------------------------------*/
+/* slab5.h                                                            */
+/* Author: Isaac Wolfe and Isaac Hart                                 */
+/*--------------------------------------------------------------------*/
+
+#ifndef SLAB5_INCLUDED
+#define SLAB5_INCLUDED
+
+#include <stddef.h>
+
+/* Small objects live in slabs rather than in Chunks. A slab is one
+   page of a region reserved for slabs alone. It holds objects of a
+   single size class, carved from the page after a small slab header,
+   and keeps its free objects in a list threaded through the objects
+   themselves, so that an object carries no header of its own. Each
+   slab is recorded in the page map (see pagemap5.h) as a page of kind
+   PAGE_SLAB that it owns itself, so that the slab of an object is
+   found by looking up the object's address. The largest object size
+   can be changed by defining SLAB_MAX_BYTES when compiling. */
+
+/* The size of the largest object served from a slab. It must be a
+   multiple of 16. */
+#ifndef SLAB_MAX_BYTES
+#define SLAB_MAX_BYTES 256
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* Allocate and return the address of an object of at least uBytes
+   bytes, where 0 < uBytes <= SLAB_MAX_BYTES, aligned like a Chunk's
+   payload. Return NULL if the request cannot be satisfied. */
+
+void *Slab_alloc(size_t uBytes);
+
+/*--------------------------------------------------------------------*/
+
+/* Free the object pointed to by pv, which must have been allocated by
+   Slab_alloc(). */
+
+void Slab_free(void *pv);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes that the object pointed to by pv, which
+   must have been allocated by Slab_alloc(), can hold. */
+
+size_t Slab_getSize(const void *pv);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes of memory that the slabs have obtained
+   from the OS. */
+
+size_t Slab_getMappedBytes(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) if every slab and slab list is valid, or 0 (FALSE)
+   otherwise. */
+
+int Slab_isValid(void);
+
+#endif
@@ -49,6 +49,13 @@ static void getArgs(int argc, char *argv[],
    process. */
 static void setCpuTimeLimit(void);
 
+#ifdef HEAPMGR_EXTENDED
+/* Return the number of kilobytes of the process's anonymous memory
+   that transparent huge pages back, as /proc/self/smaps reports, or 0
+   if it cannot be read. */
+static unsigned long getHugePageKilobytes(void);
+#endif
+
 /* Allocate and free iCount memory chunks, each of size iSize, in
    last-in-first-out order. */
 static void testLifoFixed(int iCount, int iSize);
@@ -78,6 +85,30 @@ static void testRandomRandom(int iCount, int iSize);
    implemented using a single linked list. */
 static void testWorst(int iCount, int iSize);
 
+#ifdef HEAPMGR_EXTENDED
+/* Grow VECTOR_COUNT vectors, interleaved at random, by doubling their
+   sizes with HeapMgr_realloc() from 16 bytes until they would exceed
+   iSize, when they are freed and started again, for iCount calls in
+   all. */
+static void testVectorDouble(int iCount, int iSize);
+
+/* Allocate and free iCount memory chunks, each of some random size
+   less than iSize, in a random order, as testRandomRandom does, but
+   allocate them with HeapMgr_calloc(). */
+static void testRandomCalloc(int iCount, int iSize);
+
+/* Allocate and free iCount memory chunks, each of some random size
+   less than iSize, in a random order, as testRandomRandom does, but
+   allocate them with HeapMgr_memalign() at cache line and page
+   alignments. */
+static void testRandomAlign(int iCount, int iSize);
+
+/* Allocate iCount memory chunks, one at a time, each of iSize
+   megabytes, grow each to twice that size with HeapMgr_realloc(), and
+   free it. */
+static void testHugeRealloc(int iCount, int iSize);
+#endif
+
 /*--------------------------------------------------------------------*/
 
 /* apcTestName is an array containing the names of the tests. */
@@ -86,6 +117,9 @@ static char *apcTestName[] =
 {
    "LifoFixed", "FifoFixed", "LifoRandom", "FifoRandom",
    "RandomFixed", "RandomRandom", "Worst"
+#ifdef HEAPMGR_EXTENDED
+   , "VectorDouble", "RandomCalloc", "RandomAlign", "HugeRealloc"
+#endif
 };
 
 /*--------------------------------------------------------------------*/
@@ -104,6 +138,10 @@ static TestFunction apfTestFunction[] =
 {
    testLifoFixed, testFifoFixed, testLifoRandom, testFifoRandom,
    testRandomFixed, testRandomRandom, testWorst
+#ifdef HEAPMGR_EXTENDED
+   , testVectorDouble, testRandomCalloc, testRandomAlign,
+   testHugeRealloc
+#endif
 };
 
 /*--------------------------------------------------------------------*/
@@ -119,7 +157,15 @@ static TestFunction apfTestFunction[] =
       FifoRandom: FIFO with random size chunks,
       RandomFixed: random order with fixed size chunks,
       RandomRandom: random order with random size chunks,
-      Worst: worst case for the doubly linked list implementation.
+      Worst: worst case for the doubly linked list implementation,
+      VectorDouble: growing vectors by doubling, if HEAPMGR_EXTENDED
+         is defined,
+      RandomCalloc: random order with random size zeroed chunks, if
+         HEAPMGR_EXTENDED is defined,
+      RandomAlign: random order with random size aligned chunks, if
+         HEAPMGR_EXTENDED is defined,
+      HugeRealloc: chunks of megabytes grown by doubling, if
+         HEAPMGR_EXTENDED is defined.
 
    argv[2] is the number of calls of HeapMgr_malloc() and HeapMgr_free()
    to execute. argv[2] cannot be greater than MAX_CALLS.
@@ -143,6 +189,10 @@ int main(int argc, char *argv[])
    char *pcFinalBreak;
    unsigned int uiMemoryConsumed;
    double dTimeConsumed;
+#ifdef HEAPMGR_EXTENDED
+   struct HeapMgrStats sStats;
+   unsigned long ulHugePageKilobytes;
+#endif
 
    /* Get the command-line arguments. */
    getArgs(argc, argv, &iTestNum, &iCount, &iSize);
@@ -164,15 +214,66 @@ int main(int argc, char *argv[])
    /* Save the final clock and program break. */
    pcFinalBreak = sbrk(0);
    iFinalClock = clock();
+#ifdef HEAPMGR_EXTENDED
+   ulHugePageKilobytes = getHugePageKilobytes();
+#endif
 
    /* Use the initial and final clocks and program breaks to compute
       CPU time and heap memory consumed. */
    uiMemoryConsumed = (unsigned int)(pcFinalBreak - pcInitialBreak);
+#ifdef HEAPMGR_EXTENDED
+   /* Count the memory that the HeapMgr obtained without moving the
+      program break. */
+   HeapMgr_getStats(&sStats);
+   uiMemoryConsumed += (unsigned int)sStats.uMappedBytes;
+#endif
    dTimeConsumed =
       ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC;
 
    /* Finish printing the results. */
    printf("%6.2f %10u\n", dTimeConsumed, uiMemoryConsumed);
+#ifdef HEAPMGR_EXTENDED
+   /* Print the number of bin operations per chunk freed. */
+   if (sStats.uChunkFrees != 0)
+      printf("%16s %12s %.2f bin operations per chunk freed\n", "", "",
+         (double)sStats.uBinOps / (double)sStats.uChunkFrees);
+
+   /* Print the number of blocks resized, how many were copied, and
+      how many copies remapping avoided. */
+   if (sStats.uReallocs != 0)
+      printf("%16s %12s %lu of %lu reallocs copied, %lu remapped\n",
+         "", "", (unsigned long)sStats.uReallocCopies,
+         (unsigned long)sStats.uReallocs,
+         (unsigned long)sStats.uReallocRemaps);
+
+   /* Print the number of bytes allocated zeroed, and how many had to
+      be zeroed. */
+   if (sStats.uCallocBytes != 0)
+      printf("%16s %12s %lu of %lu calloc bytes zeroed\n", "", "",
+         (unsigned long)sStats.uCallocZeroedBytes,
+         (unsigned long)sStats.uCallocBytes);
+   if (sStats.uCallocPrezeroedBytes != 0)
+      printf("%16s %12s %lu calloc bytes zeroed in advance\n", "", "",
+         (unsigned long)sStats.uCallocPrezeroedBytes);
+
+   /* Print the number of bytes whose pages were purged. */
+   if (sStats.uPurgedBytes != 0)
+      printf("%16s %12s %lu bytes purged\n", "", "",
+         (unsigned long)sStats.uPurgedBytes);
+
+   /* Print the number of calls to the OS that grew and shrank the
+      heap, and the number of bytes requested by them. */
+   if (sStats.uOsCalls != 0)
+      printf("%16s %12s %lu calls to the OS for %lu bytes\n", "", "",
+         (unsigned long)sStats.uOsCalls,
+         (unsigned long)sStats.uRequestedBytes);
+
+   /* Print the number of 2 MB transparent huge pages that back the
+      process's memory. */
+   if (ulHugePageKilobytes != 0)
+      printf("%16s %12s %lu huge pages\n", "", "",
+         ulHugePageKilobytes / 2048);
+#endif
    return 0;
 }
 
@@ -288,6 +389,31 @@ static void assure(int iSuccessful, int iLineNum)
 
 /*--------------------------------------------------------------------*/
 
+#ifdef HEAPMGR_EXTENDED
+/* Return the number of kilobytes of the process's anonymous memory
+   that transparent huge pages back, summing the AnonHugePages lines
+   of /proc/self/smaps, or 0 if it cannot be read. */
+
+static unsigned long getHugePageKilobytes(void)
+{
+   FILE *psFile;
+   char acLine[256];
+   unsigned long ulKilobytes;
+   unsigned long ulTotal = 0;
+
+   psFile = fopen("/proc/self/smaps", "r");
+   if (psFile == NULL)
+      return 0;
+   while (fgets(acLine, (int)sizeof(acLine), psFile) != NULL)
+      if (sscanf(acLine, "AnonHugePages: %lu kB", &ulKilobytes) == 1)
+         ulTotal += ulKilobytes;
+   fclose(psFile);
+   return ulTotal;
+}
+#endif
+
+/*--------------------------------------------------------------------*/
+
 /* Allocate and free iCount memory chunks, each of size iSize, in
    last-in-first-out order. */
 
@@ -789,3 +915,320 @@ static void testWorst(int iCount, int iSize)
    for (i = 0; i < iCount; i++)
       HeapMgr_free(apcChunks[i]);
 }
+
+/*--------------------------------------------------------------------*/
+
+#ifdef HEAPMGR_EXTENDED
+/* Grow VECTOR_COUNT vectors, interleaved at random, by doubling their
+   sizes with HeapMgr_realloc() from 16 bytes until they would exceed
+   iSize, when they are freed and started again, for iCount calls of
+   HeapMgr_malloc(), HeapMgr_realloc() and HeapMgr_free() in all. */
+
+static void testVectorDouble(int iCount, int iSize)
+{
+   enum {VECTOR_COUNT = 8, FIRST_SIZE = 16};
+   int i;
+   int iRand;
+
+   for (i = 0; i < iCount; i++)
+   {
+      /* Assign some random integer to iRand. */
+      iRand = rand() % VECTOR_COUNT;
+
+      if (apcChunks[iRand] == NULL)
+      {
+         aiSizes[iRand] = FIRST_SIZE;
+         apcChunks[iRand] = (char*)HeapMgr_malloc((size_t)FIRST_SIZE);
+      }
+      else if (aiSizes[iRand] > iSize / 2)
+      {
+         HeapMgr_free(apcChunks[iRand]);
+         apcChunks[iRand] = NULL;
+         continue;
+      }
+      else
+      {
+         #ifndef NDEBUG
+         {
+            /* Check the vector that is about to grow to make sure
+               that its contents haven't been corrupted. */
+            int iCol;
+            char c = (char)((iRand % 10) + '0');
+            for (iCol = 0; iCol < aiSizes[iRand]; iCol++)
+               ASSURE(apcChunks[iRand][iCol] == c);
+         }
+         #endif
+
+         aiSizes[iRand] *= 2;
+         apcChunks[iRand] = (char*)HeapMgr_realloc(apcChunks[iRand],
+            (size_t)aiSizes[iRand]);
+      }
+      if (apcChunks[iRand] == NULL)
+      {
+         printf("Malloc returned NULL.\n");
+         exit(0);
+      }
+
+      #ifndef NDEBUG
+      {
+         /* Fill the vector with some character, derived from the last
+            digit of iRand, as the other tests do. */
+         int iCol;
+         char c = (char)((iRand % 10) + '0');
+         for (iCol = 0; iCol < aiSizes[iRand]; iCol++)
+            apcChunks[iRand][iCol] = c;
+      }
+      #endif
+   }
+
+   /* Free the rest of the vectors. */
+   for (i = 0; i < VECTOR_COUNT; i++)
+   {
+      if (apcChunks[i] != NULL)
+      {
+         HeapMgr_free(apcChunks[i]);
+         apcChunks[i] = NULL;
+      }
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Allocate and free iCount memory chunks, each of some random size
+   less than iSize, in a random order, allocating them with
+   HeapMgr_calloc() as arrays of ints where the size allows. If the
+   NDEBUG macro is not defined, check that each chunk is zero before
+   filling it, so that a chunk reused after another was freed must
+   have been zeroed. */
+
+static void testRandomCalloc(int iCount, int iSize)
+{
+   int i;
+   int iRand;
+   int iLogicalArraySize;
+
+   iLogicalArraySize = (iCount / 3) + 1;
+
+   /* Fill aiSizes, an array of random integers in the range 1
+      to iSize. */
+   for (i = 0; i < iLogicalArraySize; i++)
+      aiSizes[i] = (rand() % iSize) + 1;
+
+   i = 0;
+
+   /* Call HeapMgr_calloc() and HeapMgr_free() in a randomly
+      interleaved manner. */
+   while (i < iCount)
+   {
+      /* Assign some random integer to iRand. */
+      iRand = rand() % iLogicalArraySize;
+
+      if (apcChunks[iRand] == NULL)
+      {
+         if (aiSizes[iRand] % (int)sizeof(int) == 0)
+            apcChunks[iRand] = (char*)HeapMgr_calloc(
+               (size_t)aiSizes[iRand] / sizeof(int), sizeof(int));
+         else
+            apcChunks[iRand] = (char*)HeapMgr_calloc(
+               (size_t)aiSizes[iRand], (size_t)1);
+         if (apcChunks[iRand] == NULL)
+         {
+            printf("Calloc returned NULL.\n");
+            exit(0);
+         }
+
+         #ifndef NDEBUG
+         {
+            /* Check that the chunk is zero, and fill it with some
+               character, derived from the last digit of iRand, as the
+               other tests do. */
+            int iCol;
+            char c = (char)((iRand % 10) + '0');
+            for (iCol = 0; iCol < aiSizes[iRand]; iCol++)
+            {
+               ASSURE(apcChunks[iRand][iCol] == 0);
+               apcChunks[iRand][iCol] = c;
+            }
+         }
+         #endif
+
+         i++;
+      }
+
+      /* Assign some random integer to iRand. */
+      iRand = rand() % iLogicalArraySize;
+
+      /* If apcChunks[iRand] contains a chunk, free it and set
+         apcChunks[iRand] to NULL. */
+      if (apcChunks[iRand] != NULL)
+      {
+         #ifndef NDEBUG
+         {
+            /* Check the chunk that is about to be freed to make sure
+               that its contents haven't been corrupted. */
+            int iCol;
+            char c = (char)((iRand % 10) + '0');
+            for (iCol = 0; iCol < aiSizes[iRand]; iCol++)
+               ASSURE(apcChunks[iRand][iCol] == c);
+         }
+         #endif
+
+         HeapMgr_free(apcChunks[iRand]);
+         apcChunks[iRand] = NULL;
+      }
+   }
+
+   /* Free the rest of the chunks. */
+   for (i = 0; i < iLogicalArraySize; i++)
+   {
+      if (apcChunks[i] != NULL)
+      {
+         HeapMgr_free(apcChunks[i]);
+         apcChunks[i] = NULL;
+      }
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Allocate and free iCount memory chunks, each of some random size
+   less than iSize, in a random order, allocating them with
+   HeapMgr_memalign() at some random alignment: that of a cache line,
+   as for counters that must not share one, a larger power of 2, or
+   that of a page, as for buffers of direct I/O. If the NDEBUG macro is
+   not defined, check the alignment of each chunk. */
+
+static void testRandomAlign(int iCount, int iSize)
+{
+   enum {ALIGNMENT_COUNT = 4};
+   static const size_t auAlignments[ALIGNMENT_COUNT] =
+      {64, 64, 256, 4096};
+   int i;
+   int iRand;
+   int iLogicalArraySize;
+   size_t uAlignment;
+
+   iLogicalArraySize = (iCount / 3) + 1;
+
+   /* Fill aiSizes, an array of random integers in the range 1
+      to iSize. */
+   for (i = 0; i < iLogicalArraySize; i++)
+      aiSizes[i] = (rand() % iSize) + 1;
+
+   i = 0;
+
+   /* Call HeapMgr_memalign() and HeapMgr_free() in a randomly
+      interleaved manner. */
+   while (i < iCount)
+   {
+      /* Assign some random integer to iRand. */
+      iRand = rand() % iLogicalArraySize;
+
+      if (apcChunks[iRand] == NULL)
+      {
+         uAlignment = auAlignments[rand() % ALIGNMENT_COUNT];
+         apcChunks[iRand] = (char*)HeapMgr_memalign(uAlignment,
+            (size_t)aiSizes[iRand]);
+         if (apcChunks[iRand] == NULL)
+         {
+            printf("Memalign returned NULL.\n");
+            exit(0);
+         }
+
+         #ifndef NDEBUG
+         {
+            /* Check the alignment of the chunk, and fill it with some
+               character, derived from the last digit of iRand, as the
+               other tests do. */
+            int iCol;
+            char c = (char)((iRand % 10) + '0');
+            ASSURE((size_t)apcChunks[iRand] % uAlignment == 0);
+            for (iCol = 0; iCol < aiSizes[iRand]; iCol++)
+               apcChunks[iRand][iCol] = c;
+         }
+         #endif
+
+         i++;
+      }
+
+      /* Assign some random integer to iRand. */
+      iRand = rand() % iLogicalArraySize;
+
+      /* If apcChunks[iRand] contains a chunk, free it and set
+         apcChunks[iRand] to NULL. */
+      if (apcChunks[iRand] != NULL)
+      {
+         #ifndef NDEBUG
+         {
+            /* Check the chunk that is about to be freed to make sure
+               that its contents haven't been corrupted. */
+            int iCol;
+            char c = (char)((iRand % 10) + '0');
+            for (iCol = 0; iCol < aiSizes[iRand]; iCol++)
+               ASSURE(apcChunks[iRand][iCol] == c);
+         }
+         #endif
+
+         HeapMgr_free(apcChunks[iRand]);
+         apcChunks[iRand] = NULL;
+      }
+   }
+
+   /* Free the rest of the chunks. */
+   for (i = 0; i < iLogicalArraySize; i++)
+   {
+      if (apcChunks[i] != NULL)
+      {
+         HeapMgr_free(apcChunks[i]);
+         apcChunks[i] = NULL;
+      }
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Allocate iCount memory chunks, one at a time, each of iSize
+   megabytes, grow each to twice that size with HeapMgr_realloc(), and
+   free it. Chunks of a few gigabytes exceed MAX_UNITS_PER_CHUNK in the
+   compact layout, which bounds only the chunks of the heap, and so
+   must be mapped. If the NDEBUG macro is not defined, set and check
+   the bytes at the ends of each chunk, which are all that it touches,
+   so that its pages need not be backed. */
+
+static void testHugeRealloc(int iCount, int iSize)
+{
+   size_t uBytes = (size_t)iSize * 1024 * 1024;
+   char *pc;
+   int i;
+
+   for (i = 0; i < iCount; i++)
+   {
+      pc = (char*)HeapMgr_malloc(uBytes);
+      if (pc == NULL)
+      {
+         printf("Malloc returned NULL.\n");
+         exit(0);
+      }
+
+      #ifndef NDEBUG
+      pc[0] = (char)((i % 10) + '0');
+      pc[uBytes - 1] = (char)((i % 10) + '0');
+      #endif
+
+      pc = (char*)HeapMgr_realloc(pc, 2 * uBytes);
+      if (pc == NULL)
+      {
+         printf("Realloc returned NULL.\n");
+         exit(0);
+      }
+
+      #ifndef NDEBUG
+      ASSURE(pc[0] == (char)((i % 10) + '0'));
+      ASSURE(pc[uBytes - 1] == (char)((i % 10) + '0'));
+      pc[2 * uBytes - 1] = (char)((i % 10) + '0');
+      #endif
+
+      HeapMgr_free(pc);
+   }
+}
+#endif
@@ -0,0 +1,369 @@
+/*--------------------------------------------------------------------*/
+/* zeropool5.c                                                        */
+/* Author: Isaac Wolfe and Isaac Hart                                 */
+/*--------------------------------------------------------------------*/
+
+#include "zeropool5.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+/* In lieu of a boolean data type. */
+enum {FALSE, TRUE};
+
+/*--------------------------------------------------------------------*/
+
+/* The number of sizes that the pool follows. */
+enum {POOL_SLOTS = 4};
+
+/*--------------------------------------------------------------------*/
+
+/* The state of the pool. Every variable below except bStarted and
+   bFailed is guarded by oMutex. */
+
+/* The mutex, the condition on which the helper thread waits for
+   Chunks to zero, and the condition on which the caller's thread waits
+   for the helper thread to finish zeroing a Chunk. */
+static pthread_mutex_t oMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t oDirtyCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t oIdleCond = PTHREAD_COND_INITIALIZER;
+
+/* Whether the helper thread is zeroing a Chunk that is in no list. */
+static int bZeroing = FALSE;
+
+/* Whether the helper thread has been started, and whether starting it
+   failed, which disables the pool. Only the caller's thread uses
+   them. */
+static int bStarted = FALSE;
+static int bFailed = FALSE;
+
+/* The slots: slot i follows requests of auSlotUnits[i] units, or none
+   if that is 0, and has counted auSlotCounts[i] of them. Its Chunks
+   that are still to be zeroed are in the list aoDirty[i], and those
+   that are zeroed in the list aoClean[i], linked through their
+   headers. auSlotBytes[i] is the number of bytes of its Chunks,
+   including one that the helper thread may be zeroing. auSlotGens[i]
+   counts the sizes that it has followed, so that the helper thread
+   can tell whether the slot has changed while it zeroed a Chunk. */
+static size_t auSlotUnits[POOL_SLOTS];
+static size_t auSlotCounts[POOL_SLOTS];
+static Chunk_T aoDirty[POOL_SLOTS];
+static Chunk_T aoClean[POOL_SLOTS];
+static size_t auSlotBytes[POOL_SLOTS];
+static size_t auSlotGens[POOL_SLOTS];
+
+/* The list of Chunks given back, which are to be freed. */
+static Chunk_T oEvicted = NULL;
+
+/* The number of bytes of all the pool's Chunks, including those given
+   back that are not yet freed. */
+static size_t uPoolBytes = 0;
+
+/*--------------------------------------------------------------------*/
+
+/* Static function declarations */
+
+/* Start the helper thread. Return TRUE if successful, and FALSE
+   otherwise. */
+static int ZeroPool_start(void);
+
+/* Zero the Chunks of the slots as they are added. */
+static void *ZeroPool_run(void *pvArg);
+
+/* Give back the Chunks of the list that starts with oChunk. */
+static void ZeroPool_evictList(Chunk_T oChunk);
+
+/*--------------------------------------------------------------------*/
+
+/* Start the helper thread, detached, so that it runs until the
+   process ends. Return TRUE if successful, and FALSE otherwise. */
+
+static int ZeroPool_start(void)
+{
+   pthread_attr_t oAttr;
+   pthread_t oThread;
+   int iError;
+
+   if (pthread_attr_init(&oAttr) != 0)
+      return FALSE;
+   pthread_attr_setdetachstate(&oAttr, PTHREAD_CREATE_DETACHED);
+   iError = pthread_create(&oThread, &oAttr, ZeroPool_run, NULL);
+   pthread_attr_destroy(&oAttr);
+   return iError == 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Wait for a Chunk to be added to a slot's dirty list, take it, zero
+   its payload outside the mutex, and add it to the slot's clean list,
+   or give it back if the slot has since come to follow another size.
+   The number of bytes to zero is recorded in the payload, since the
+   caller's thread may be changing the Chunk's header meanwhile. Never
+   return. */
+
+static void *ZeroPool_run(void *pvArg)
+{
+   Chunk_T oChunk;
+   void *pv;
+   size_t uBytes;
+   size_t uGen;
+   int iSlot;
+
+   (void)pvArg;
+
+   pthread_mutex_lock(&oMutex);
+   for (;;)
+   {
+      for (iSlot = 0; iSlot < POOL_SLOTS; iSlot++)
+         if (aoDirty[iSlot] != NULL)
+            break;
+      if (iSlot == POOL_SLOTS)
+      {
+         pthread_cond_wait(&oDirtyCond, &oMutex);
+         continue;
+      }
+
+      oChunk = aoDirty[iSlot];
+      aoDirty[iSlot] = Chunk_getNextInList(oChunk);
+      uGen = auSlotGens[iSlot];
+      bZeroing = TRUE;
+      pthread_mutex_unlock(&oMutex);
+
+      pv = Chunk_toPayload(oChunk);
+      uBytes = *(size_t*)pv;
+      memset(pv, 0, uBytes);
+
+      pthread_mutex_lock(&oMutex);
+      bZeroing = FALSE;
+      pthread_cond_signal(&oIdleCond);
+      if (auSlotGens[iSlot] == uGen)
+      {
+         Chunk_setNextInList(oChunk, aoClean[iSlot]);
+         aoClean[iSlot] = oChunk;
+      }
+      else
+      {
+         Chunk_setNextInList(oChunk, oEvicted);
+         oEvicted = oChunk;
+      }
+   }
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Give back the Chunks of the list that starts with oChunk, adding
+   them to the evicted list. oMutex must be locked. */
+
+static void ZeroPool_evictList(Chunk_T oChunk)
+{
+   Chunk_T oNextChunk;
+
+   for (; oChunk != NULL; oChunk = oNextChunk)
+   {
+      oNextChunk = Chunk_getNextInList(oChunk);
+      Chunk_setNextInList(oChunk, oEvicted);
+      oEvicted = oChunk;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+Chunk_T ZeroPool_take(size_t uUnits)
+{
+   Chunk_T oChunk = NULL;
+   size_t uBytes;
+   int iSlot;
+   int iMin = 0;
+
+   assert(uUnits >= MIN_UNITS_PER_CHUNK);
+
+   if (Chunk_unitsToBytes(uUnits) < PREZERO_MIN_BYTES)
+      return NULL;
+   if (! bStarted)
+   {
+      if (bFailed)
+         return NULL;
+      if (! ZeroPool_start())
+      {
+         bFailed = TRUE;
+         return NULL;
+      }
+      bStarted = TRUE;
+   }
+
+   pthread_mutex_lock(&oMutex);
+
+   /* Count the request, and serve it from the reserve if possible. */
+   for (iSlot = 0; iSlot < POOL_SLOTS; iSlot++)
+      if (auSlotUnits[iSlot] == uUnits)
+         break;
+   if (iSlot < POOL_SLOTS)
+   {
+      auSlotCounts[iSlot]++;
+      oChunk = aoClean[iSlot];
+      if (oChunk != NULL)
+      {
+         aoClean[iSlot] = Chunk_getNextInList(oChunk);
+         uBytes = Chunk_unitsToBytes(Chunk_getUnits(oChunk));
+         auSlotBytes[iSlot] -= uBytes;
+         uPoolBytes -= uBytes;
+      }
+      pthread_mutex_unlock(&oMutex);
+      return oChunk;
+   }
+
+   /* Follow the size instead of the one counted least, counting it
+      once more than that one, and give back that one's Chunks. */
+   for (iSlot = 1; iSlot < POOL_SLOTS; iSlot++)
+      if (auSlotCounts[iSlot] < auSlotCounts[iMin])
+         iMin = iSlot;
+   ZeroPool_evictList(aoDirty[iMin]);
+   ZeroPool_evictList(aoClean[iMin]);
+   aoDirty[iMin] = NULL;
+   aoClean[iMin] = NULL;
+   auSlotUnits[iMin] = uUnits;
+   auSlotCounts[iMin]++;
+   auSlotBytes[iMin] = 0;
+   auSlotGens[iMin]++;
+   pthread_mutex_unlock(&oMutex);
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+int ZeroPool_give(Chunk_T oChunk)
+{
+   size_t uUnits;
+   size_t uBytes;
+   void *pv;
+   int iSlot;
+
+   assert(oChunk != NULL);
+   assert(Chunk_getStatus(oChunk) == CHUNK_INUSE);
+
+   if (! bStarted)
+      return FALSE;
+
+   uUnits = Chunk_getUnits(oChunk);
+   uBytes = Chunk_unitsToBytes(uUnits);
+
+   pthread_mutex_lock(&oMutex);
+
+   /* Find the slot that follows the sizes of requests that oChunk can
+      serve, if there is room for it. */
+   for (iSlot = 0; iSlot < POOL_SLOTS; iSlot++)
+      if ((auSlotUnits[iSlot] != 0) && (auSlotUnits[iSlot] <= uUnits)
+         && (uUnits < auSlotUnits[iSlot] + MIN_UNITS_PER_CHUNK))
+         break;
+   if ((iSlot == POOL_SLOTS)
+      || (uPoolBytes + uBytes > PREZERO_MAX_BYTES)
+      || (auSlotBytes[iSlot] + uBytes > PREZERO_MAX_BYTES / POOL_SLOTS))
+   {
+      pthread_mutex_unlock(&oMutex);
+      return FALSE;
+   }
+
+   /* Record the number of bytes to zero for the helper thread, and wake
+      it. */
+   pv = Chunk_toPayload(oChunk);
+   *(size_t*)pv = uBytes - (size_t)((char*)pv - (char*)oChunk);
+   Chunk_setNextInList(oChunk, aoDirty[iSlot]);
+   aoDirty[iSlot] = oChunk;
+   auSlotBytes[iSlot] += uBytes;
+   uPoolBytes += uBytes;
+   pthread_cond_signal(&oDirtyCond);
+   pthread_mutex_unlock(&oMutex);
+   return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+Chunk_T ZeroPool_evict(void)
+{
+   Chunk_T oChunk;
+
+   if (! bStarted)
+      return NULL;
+
+   pthread_mutex_lock(&oMutex);
+   oChunk = oEvicted;
+   if (oChunk != NULL)
+   {
+      oEvicted = Chunk_getNextInList(oChunk);
+      uPoolBytes -= Chunk_unitsToBytes(Chunk_getUnits(oChunk));
+   }
+   pthread_mutex_unlock(&oMutex);
+   return oChunk;
+}
+
+/*--------------------------------------------------------------------*/
+
+void ZeroPool_flush(void)
+{
+   int iSlot;
+
+   if (! bStarted)
+      return;
+
+   pthread_mutex_lock(&oMutex);
+
+   /* Wait for the helper thread to finish the Chunk that it is zeroing,
+      which is in no list meanwhile. */
+   while (bZeroing)
+      pthread_cond_wait(&oIdleCond, &oMutex);
+
+   /* Give back every slot's Chunks, but keep following the sizes. */
+   for (iSlot = 0; iSlot < POOL_SLOTS; iSlot++)
+   {
+      ZeroPool_evictList(aoDirty[iSlot]);
+      ZeroPool_evictList(aoClean[iSlot]);
+      aoDirty[iSlot] = NULL;
+      aoClean[iSlot] = NULL;
+      auSlotBytes[iSlot] = 0;
+   }
+
+   pthread_mutex_unlock(&oMutex);
+}
+
+/*--------------------------------------------------------------------*/
+
+int ZeroPool_isValid(void)
+{
+   Chunk_T oChunk;
+   size_t uBytes = 0;
+   int iSlot;
+   int bValid = TRUE;
+
+   pthread_mutex_lock(&oMutex);
+
+   /* Is every clean Chunk in use, of its slot's size, and zero? */
+   for (iSlot = 0; iSlot < POOL_SLOTS; iSlot++)
+   {
+      for (oChunk = aoClean[iSlot];
+           oChunk != NULL;
+           oChunk = Chunk_getNextInList(oChunk))
+         if ((Chunk_getStatus(oChunk) != CHUNK_INUSE)
+            || (Chunk_getUnits(oChunk) < auSlotUnits[iSlot])
+            || (Chunk_getUnits(oChunk)
+               >= auSlotUnits[iSlot] + MIN_UNITS_PER_CHUNK)
+            || (*(char*)Chunk_toPayload(oChunk) != 0))
+         {
+            fprintf(stderr, "The zero pool holds a bad chunk\n");
+            bValid = FALSE;
+         }
+      uBytes += auSlotBytes[iSlot];
+   }
+
+   /* Are the slots' Chunks within the bounds? */
+   if ((uBytes > uPoolBytes) || (uPoolBytes > PREZERO_MAX_BYTES))
+   {
+      fprintf(stderr, "The zero pool has a bad size\n");
+      bValid = FALSE;
+   }
+
+   pthread_mutex_unlock(&oMutex);
+   return bValid;
+}
@@ -0,0 +1,91 @@
+/*--------------------------------------------------------------------*/
+/* zeropool5.h                                                        */
+/* Author: Isaac Wolfe and Isaac Hart                                 */
+/*--------------------------------------------------------------------*/
+
+#ifndef ZEROPOOL5_INCLUDED
+#define ZEROPOOL5_INCLUDED
+
+#include "chunk5.h"
+#include <stddef.h>
+
+/* The zero pool keeps a reserve of zeroed Chunks of the sizes most
+   often allocated zeroed, so that HeapMgr_calloc can serve them
+   without zeroing them itself. Its Chunks are in use as far as the
+   heap is concerned. It follows a few sizes, those of the requests
+   counted most often by the Space-Saving algorithm: a request of a
+   size that it does not follow takes the place of the size counted
+   least, and the Chunks of that size are given back. A freed Chunk of
+   a size that it follows joins the reserve, and a helper thread, which
+   the pool starts when first used, zeroes it while the caller goes
+   on. The pool's state is guarded by a mutex, since the helper thread
+   shares it; it is the helper thread's only contact with the heap.
+
+   Since its Chunks keep the heap from returning the memory around
+   them, the pool gives back its reserve when HeapMgr_trim is called,
+   and when HeapMgr_free has offered it PREZERO_IDLE_FREES Chunks
+   without HeapMgr_calloc consulting it.
+
+   The pool is part of heapmgr5 only if HEAPMGR_PREZERO is defined
+   when compiling, in which case the program must be linked with the
+   POSIX threads library. The sizes below can be changed by defining
+   the macros when compiling. */
+
+/* The largest number of bytes of Chunks that the pool can hold. */
+#ifndef PREZERO_MAX_BYTES
+#define PREZERO_MAX_BYTES ((size_t)8 * 1024 * 1024)
+#endif
+
+/* The number of bytes of the smallest request that the pool counts:
+   smaller blocks are zeroed as quickly as they can be found. */
+#ifndef PREZERO_MIN_BYTES
+#define PREZERO_MIN_BYTES ((size_t)1024)
+#endif
+
+/* The number of chunks that HeapMgr_free offers to the pool without
+   HeapMgr_calloc consulting it in between, after which the pool gives
+   back its reserve. */
+#ifndef PREZERO_IDLE_FREES
+#define PREZERO_IDLE_FREES ((size_t)256)
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* Count a request for a zeroed Chunk of uUnits units. Return a zeroed
+   Chunk of at least uUnits units, and fewer than uUnits +
+   MIN_UNITS_PER_CHUNK, from the reserve, or NULL if there is none. */
+
+Chunk_T ZeroPool_take(size_t uUnits);
+
+/*--------------------------------------------------------------------*/
+
+/* Add oChunk, which is being freed, to the reserve if the pool follows
+   its size and has room for it, for the helper thread to zero. Return
+   1 (TRUE) if the pool took oChunk, or 0 (FALSE) if it is still to be
+   freed. */
+
+int ZeroPool_give(Chunk_T oChunk);
+
+/*--------------------------------------------------------------------*/
+
+/* Return a Chunk that the pool has given back, which is to be freed,
+   or NULL if there is none. */
+
+Chunk_T ZeroPool_evict(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Give back every Chunk of the reserve, waiting for the helper thread
+   to finish zeroing one if need be. The Chunks are then returned by
+   ZeroPool_evict(). */
+
+void ZeroPool_flush(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) if the pool's state is valid, or 0 (FALSE)
+   otherwise. */
+
+int ZeroPool_isValid(void);
+
+#endif